@@ -0,0 +1,29 @@
+///
+/// compose.hpp
+/// llo
+///
+/// Purpose:
+/// Define llo composition of data movement functors into consumers
+///
+
+#include "opt/compose.hpp"
+
+#include "llo/data.hpp"
+
+#ifndef LLO_COMPOSE_HPP
+#define LLO_COMPOSE_HPP
+
+namespace llo
+{
+
+/// Return graph of root where single argument SUM, PROD, MIN and MAX
+/// functors that only permute, flip or extend their argument (e.g.:
+/// permute, transpose, extend and flip) are removed by mapping their
+/// consumers directly onto the moved tensor
+/// MATMUL and CONV2D consumers are never remapped,
+/// since their kernels ignore argument mappings
+ade::TensptrT compose_maps (ade::TensptrT root);
+
+}
+
+#endif // LLO_COMPOSE_HPP
@@ -0,0 +1,231 @@
+///
+/// contiguous.hpp
+/// llo
+///
+/// Purpose:
+/// Define elementwise operations as named functors, and loops applying
+/// them to contiguous arrays (every argument mapped by identity)
+/// Loops over float, double, and int32_t data of common operations
+/// are compiled for multiple instruction sets and dispatched at load time
+/// Under glibc, sin, cos, exp, log and pow loops call the vector math
+/// library, so they agree with std functions within 4 ulp
+///
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#ifndef LLO_CONTIGUOUS_HPP
+#define LLO_CONTIGUOUS_HPP
+
+namespace llo
+{
+
+/// Absolute value
+struct AbsOp final
+{
+	template <typename T>
+	T operator () (const T& src) const { return std::abs(src); }
+};
+
+/// Negation
+struct NegOp final
+{
+	template <typename T>
+	T operator () (const T& src) const { return -src; }
+};
+
+/// Sine
+struct SinOp final
+{
+	template <typename T>
+	T operator () (const T& src) const { return std::sin(src); }
+};
+
+/// Cosine
+struct CosOp final
+{
+	template <typename T>
+	T operator () (const T& src) const { return std::cos(src); }
+};
+
+/// Natural exponent
+struct ExpOp final
+{
+	template <typename T>
+	T operator () (const T& src) const { return std::exp(src); }
+};
+
+/// Natural log
+struct LogOp final
+{
+	template <typename T>
+	T operator () (const T& src) const { return std::log(src); }
+};
+
+/// Square root
+struct SqrtOp final
+{
+	template <typename T>
+	T operator () (const T& src) const { return std::sqrt(src); }
+};
+
+/// Power of a to the b
+struct PowOp final
+{
+	template <typename T>
+	T operator () (const T& a, const T& b) const { return std::pow(a, b); }
+};
+
+/// Difference of a and b
+struct SubOp final
+{
+	template <typename T>
+	T operator () (const T& a, const T& b) const { return a - b; }
+};
+
+/// Quotient of a and b
+struct DivOp final
+{
+	template <typename T>
+	T operator () (const T& a, const T& b) const { return a / b; }
+};
+
+/// 1 if a == b else 0
+struct EqOp final
+{
+	template <typename T>
+	T operator () (const T& a, const T& b) const { return a == b; }
+};
+
+/// 1 if a != b else 0
+struct NeqOp final
+{
+	template <typename T>
+	T operator () (const T& a, const T& b) const { return a != b; }
+};
+
+/// 1 if a < b else 0
+struct LtOp final
+{
+	template <typename T>
+	T operator () (const T& a, const T& b) const { return a < b; }
+};
+
+/// 1 if a > b else 0
+struct GtOp final
+{
+	template <typename T>
+	T operator () (const T& a, const T& b) const { return a > b; }
+};
+
+/// Accumulate by sum
+struct AddAcc final
+{
+	template <typename T>
+	void operator () (T& out, const T& val) const { out += val; }
+};
+
+/// Accumulate by product
+struct MulAcc final
+{
+	template <typename T>
+	void operator () (T& out, const T& val) const { out *= val; }
+};
+
+/// Accumulate by minimum
+struct MinAcc final
+{
+	template <typename T>
+	void operator () (T& out, const T& val) const { out = std::min(out, val); }
+};
+
+/// Accumulate by maximum
+struct MaxAcc final
+{
+	template <typename T>
+	void operator () (T& out, const T& val) const { out = std::max(out, val); }
+};
+
+/// Set out[i] to f(in[i]) for i in [0, n)
+template <typename T, typename F>
+void contiguous_unary (T* out, const T* in, size_t n, F f)
+{
+	for (size_t i = 0; i < n; ++i)
+	{
+		out[i] = f(in[i]);
+	}
+}
+
+/// Set out[i] to f(a[i], b[i]) for i in [0, n)
+template <typename OUT, typename ATYPE, typename BTYPE, typename F>
+void contiguous_binary (OUT* out,
+	const ATYPE* a, const BTYPE* b, size_t n, F f)
+{
+	for (size_t i = 0; i < n; ++i)
+	{
+		out[i] = f(a[i], b[i]);
+	}
+}
+
+/// Apply acc(out[i], in[i]) for i in [0, n)
+template <typename T, typename Acc>
+void contiguous_acc (T* out, const T* in, size_t n, Acc acc)
+{
+	for (size_t i = 0; i < n; ++i)
+	{
+		acc(out[i], in[i]);
+	}
+}
+
+// Overloads below are preferred over the templates above,
+// and are defined once per instruction set in contiguous.cpp
+
+#define _CONTIG_UNARY(OP, TYPE)\
+void contiguous_unary (TYPE* out, const TYPE* in, size_t n, OP f);
+
+#define _CONTIG_BINARY(OP, TYPE)\
+void contiguous_binary (TYPE* out, const TYPE* a, const TYPE* b,\
+	size_t n, OP f);
+
+#define _CONTIG_ACC(OP, TYPE)\
+void contiguous_acc (TYPE* out, const TYPE* in, size_t n, OP acc);
+
+#define _CONTIG_REAL(TYPE)\
+_CONTIG_UNARY(SinOp, TYPE)\
+_CONTIG_UNARY(CosOp, TYPE)\
+_CONTIG_UNARY(ExpOp, TYPE)\
+_CONTIG_UNARY(LogOp, TYPE)\
+_CONTIG_UNARY(SqrtOp, TYPE)\
+_CONTIG_BINARY(PowOp, TYPE)\
+_CONTIG_BINARY(DivOp, TYPE)
+
+#define _CONTIG_COMMON(TYPE)\
+_CONTIG_UNARY(AbsOp, TYPE)\
+_CONTIG_UNARY(NegOp, TYPE)\
+_CONTIG_BINARY(SubOp, TYPE)\
+_CONTIG_BINARY(EqOp, TYPE)\
+_CONTIG_BINARY(NeqOp, TYPE)\
+_CONTIG_BINARY(LtOp, TYPE)\
+_CONTIG_BINARY(GtOp, TYPE)\
+_CONTIG_ACC(AddAcc, TYPE)\
+_CONTIG_ACC(MulAcc, TYPE)\
+_CONTIG_ACC(MinAcc, TYPE)\
+_CONTIG_ACC(MaxAcc, TYPE)
+
+_CONTIG_REAL(double)
+_CONTIG_REAL(float)
+_CONTIG_COMMON(double)
+_CONTIG_COMMON(float)
+_CONTIG_COMMON(int32_t)
+
+#undef _CONTIG_COMMON
+#undef _CONTIG_REAL
+#undef _CONTIG_ACC
+#undef _CONTIG_BINARY
+#undef _CONTIG_UNARY
+
+}
+
+#endif // LLO_CONTIGUOUS_HPP
@@ -0,0 +1,38 @@
+///
+/// cse.hpp
+/// llo
+///
+/// Purpose:
+/// Define llo common subexpression elimination
+///
+
+#include "opt/cse.hpp"
+
+#include "llo/data.hpp"
+
+#ifndef LLO_CSE_HPP
+#define LLO_CSE_HPP
+
+namespace llo
+{
+
+/// Return key of leaf's type, shape and hash of data if leaf is
+/// a Constant or constant Variable, otherwise return empty string
+/// Data is hashed in place, so large constants are never copied
+std::string constant_key (ade::iLeaf* leaf);
+
+/// Return true if constant leaves a and b of the same constant_key
+/// hold the same data, telling apart constants whose hashes collide
+bool equal_constants (ade::iLeaf* a, ade::iLeaf* b);
+
+/// Return true if func can be merged with equal functors,
+/// which excludes random sampling and fused functors
+bool is_mergeable (ade::iFunctor* func);
+
+/// Return graph of root where equal subgraphs and
+/// constants of equal data are merged into single nodes
+ade::TensptrT merge_common (ade::TensptrT root);
+
+}
+
+#endif // LLO_CSE_HPP
@@ -8,6 +8,7 @@
 ///
 
 #include <memory>
+#include <mutex>
 
 #include "ade/coord.hpp"
 #include "ade/ileaf.hpp"
@@ -27,6 +28,11 @@ struct GenericData final
 
 	GenericData (ade::Shape shape, age::_GENERATED_DTYPE dtype);
 
+	/// Wrap existing block of data without copying it
+	GenericData (std::shared_ptr<char> data, ade::Shape shape,
+		age::_GENERATED_DTYPE dtype) :
+		data_(data), shape_(shape), dtype_(dtype) {}
+
 	/// Copy over data of specified type while retaining shape
 	/// This makes the assumption that the indata fits in shape perfectly
 	void copyover (const char* indata, age::_GENERATED_DTYPE intype);
@@ -79,22 +85,35 @@ struct Variable final : public ade::iLeaf
 		}
 	}
 
+	/// Adopt data owned by the caller without copying it
+	/// The caller's storage is released by the deleter of data.data_
+	/// Assignment writes to the storage in place only if writable
+	/// (e.g.: copy-on-write mappings), otherwise it is never written to
+	/// (e.g.: read-only mappings)
+	Variable (GenericData data, std::string label, bool writable = false) :
+		label_(label), data_(data), owned_(writable) {}
+
 	Variable (const Variable& other) :
-		label_(other.label_), data_(other.shape(), (age::_GENERATED_DTYPE) other.type_code())
+		label_(other.label_), constant_(other.constant_),
+		data_(other.shape(), (age::_GENERATED_DTYPE) other.type_code())
 	{
 		std::memcpy((char*) data_.data_.get(), (const char*) other.data(), nbytes());
 	}
 
 	Variable (Variable&& other) :
-		label_(std::move(other.label_)), data_(std::move(other.data_)) {}
+		label_(std::move(other.label_)), constant_(other.constant_),
+		data_(std::move(other.data_)), owned_(other.owned_) {}
 
 	Variable& operator = (const Variable& other)
 	{
 		if (this != &other)
 		{
 			label_ = other.label_;
+			constant_ = other.constant_;
 			data_ = GenericData(other.shape(), (age::_GENERATED_DTYPE) other.type_code());
 			std::memcpy((char*) data_.data_.get(), (const char*) other.data(), nbytes());
+			owned_ = true;
+			++version_;
 		}
 		return *this;
 	}
@@ -104,7 +123,10 @@ struct Variable final : public ade::iLeaf
 		if (this != &other)
 		{
 			label_ = std::move(other.label_);
+			constant_ = other.constant_;
 			data_ = std::move(other.data_);
+			owned_ = other.owned_;
+			++version_;
 		}
 		return *this;
 	}
@@ -120,22 +142,35 @@ struct Variable final : public ade::iLeaf
 	/// Assign generic reference to data source
 	Variable& operator = (GenericRef data)
 	{
-		if (false == data.shape_.compatible_after(shape(), 0))
-		{
-			logs::fatalf("cannot assign data of incompatible shaped %s to "
-				"internal data of shape %s", data.shape_.to_string().c_str(),
-				shape().to_string().c_str());
-		}
-		if (data.dtype_ != data_.dtype_)
+		validate(data.shape_, data.dtype_);
+		if (false == owned_ || data_.data_.use_count() > 1)
 		{
-			logs::fatalf("cannot assign data of incompatible types %s "
-				"(external) and %s (internal)",
-				age::name_type(data.dtype_).c_str(), age::name_type(data_.dtype_).c_str());
+			// data is adopted or shared by evaluations, so write to a new
+			// buffer instead of changing the caller's data or their results
+			data_ = GenericData(data_.shape_, data_.dtype_);
+			owned_ = true;
 		}
 		std::memcpy(data_.data_.get(), data.data_, nbytes());
+		++version_;
 		return *this;
 	}
 
+	/// Replace data source with data owned by the caller without copying it
+	void adopt (GenericData data)
+	{
+		validate(data.shape_, data.dtype_);
+		data_ = data;
+		owned_ = false;
+		++version_;
+	}
+
+	/// Return data shared with the variable, which must not be modified
+	/// Data returned stays unchanged by later assignments
+	GenericData share (void) const
+	{
+		return data_;
+	}
+
 	/// Implementation of iTensor
 	const ade::Shape& shape (void) const override
 	{
@@ -175,9 +210,38 @@ struct Variable final : public ade::iLeaf
 	/// Label for distinguishing variable nodes
 	std::string label_;
 
+	/// True if data is never assigned after construction,
+	/// so optimizations can treat variables of equal data as the same
+	bool constant_ = false;
+
+	/// Number of assignments to data, used to detect stale results
+	/// Writes through data() bypass assignment and must bump it themselves
+	size_t version_ = 0;
+
 private:
+	/// Throw error if data of shape and dtype cannot replace data source
+	void validate (const ade::Shape& shape, age::_GENERATED_DTYPE dtype) const
+	{
+		if (false == shape.compatible_after(data_.shape_, 0))
+		{
+			logs::fatalf("cannot assign data of incompatible shaped %s to "
+				"internal data of shape %s", shape.to_string().c_str(),
+				data_.shape_.to_string().c_str());
+		}
+		if (dtype != data_.dtype_)
+		{
+			logs::fatalf("cannot assign data of incompatible types %s "
+				"(external) and %s (internal)",
+				age::name_type(dtype).c_str(), age::name_type(data_.dtype_).c_str());
+		}
+	}
+
 	/// Generic data source
 	GenericData data_;
+
+	/// True if data_ is allocated by the variable or adopted as writable,
+	/// so it can be written to
+	bool owned_ = true;
 };
 
 /// Smart pointer for variable nodes
@@ -187,7 +251,7 @@ using VarptrT = std::shared_ptr<llo::Variable>;
 /// specified shape and labelled according to input label
 /// Throw error if the input vector size differs from shape.n_elems()
 template <typename T>
-VarptrT get_variable (std::vector<T> data, ade::Shape shape,
+VarptrT get_variable (const std::vector<T>& data, ade::Shape shape,
 	std::string label = "")
 {
 	if (data.size() != shape.n_elems())
@@ -195,10 +259,26 @@ VarptrT get_variable (std::vector<T> data, ade::Shape shape,
 		logs::fatalf("cannot create variable with data size %d "
 			"against shape %s", data.size(), shape.to_string().c_str());
 	}
-	return VarptrT(new Variable((char*) &data[0],
+	return VarptrT(new Variable((const char*) data.data(),
 		age::get_type<T>(), shape, label));
 }
 
+/// Return new variable using input data of specified shape without copying,
+/// where data holds at least shape.n_elems() elements and its deleter
+/// releases the caller's storage once no variable or evaluation uses it
+template <typename T>
+VarptrT get_variable (std::shared_ptr<T> data, ade::Shape shape,
+	std::string label = "")
+{
+	if (nullptr == data)
+	{
+		logs::fatal("cannot create variable with null data");
+	}
+	return VarptrT(new Variable(GenericData(
+		std::shared_ptr<char>(data, (char*) data.get()),
+		shape, age::get_type<T>()), label));
+}
+
 /// Return new variable containing 0s according to
 /// specified shape and labelled according to input label
 template <typename T>
@@ -207,19 +287,111 @@ VarptrT get_variable (ade::Shape shape, std::string label = "")
 	return get_variable(std::vector<T>(shape.n_elems(), 0), shape, label);
 }
 
-/// Return new variable containing 0s according to
+/// Leaf node of some shape where every element holds the same value
+/// Only the value is stored, llo evaluators read it through the broadcast
+/// mapping wherever consumers allow, so the full shape is never allocated
+/// Data of the full shape is only expanded the first time data is called
+struct Constant final : public ade::iLeaf
+{
+	Constant (const char* value, age::_GENERATED_DTYPE dtype,
+		ade::Shape shape, std::string label) :
+		label_(label), value_(ade::Shape(), dtype), shape_(shape)
+	{
+		std::memcpy(value_.data_.get(), value, type_size(dtype));
+	}
+
+	/// Implementation of iTensor
+	const ade::Shape& shape (void) const override
+	{
+		return shape_;
+	}
+
+	/// Implementation of iTensor
+	std::string to_string (void) const override
+	{
+		return label_ + "(" + shape_.to_string() + ")";
+	}
+
+	/// Implementation of iLeaf, data must not be modified
+	void* data (void) override
+	{
+		return (void*) static_cast<const Constant*>(this)->data();
+	}
+
+	/// Implementation of iLeaf
+	const void* data (void) const override
+	{
+		std::call_once(expanded_,
+			[this]()
+			{
+				full_ = GenericData(shape_, value_.dtype_);
+				fill(full_);
+			});
+		return full_.data_.get();
+	}
+
+	/// Implementation of iLeaf
+	size_t type_code (void) const override
+	{
+		return value_.dtype_;
+	}
+
+	/// Return pointer to the single value of type type_code()
+	const char* value (void) const
+	{
+		return value_.data_.get();
+	}
+
+	/// Write the value converted to out's type to every element of out
+	void fill (GenericData& out) const;
+
+	/// Label for distinguishing constant nodes
+	std::string label_;
+
+private:
+	/// Value of every element
+	GenericData value_;
+
+	ade::Shape shape_;
+
+	/// Full shaped data expanded on demand
+	mutable GenericData full_;
+
+	mutable std::once_flag expanded_;
+};
+
+/// Smart pointer for constant nodes
+using ConstptrT = std::shared_ptr<llo::Constant>;
+
+/// Return new constant of scalar according to
 /// specified shape and labelled according to input label
 template <typename T>
-VarptrT get_scalar (T scalar, ade::Shape shape, std::string label = "")
+ConstptrT get_scalar (T scalar, ade::Shape shape, std::string label = "")
 {
 	if (label.empty())
 	{
 		label = fmts::to_string(scalar);
 	}
-	return llo::get_variable(std::vector<T>(shape.n_elems(),scalar),
-		shape, label);
+	return ConstptrT(new Constant((char*) &scalar,
+		age::get_type<T>(), shape, label));
 }
 
+/// Pull mapping of every coordinate onto the origin,
+/// used to read a single value as any shape
+extern ade::CoordptrT broadcast;
+
+/// Return true if consumer reads a constant mapped by arg the same way
+/// when the constant is replaced by its single value mapped by broadcast
+/// Unary consumers, consumers ignoring argument mappings (e.g.: MATMUL)
+/// and pushes that accumulate multiple elements into one
+/// (e.g.: reductions) need the full shaped data instead
+bool can_broadcast (age::_GENERATED_OPCODE consumer,
+	const ade::MappedTensor& arg);
+
+/// Return true if func samples random values (e.g.: RAND_UNIF),
+/// so its evaluations differ even when its arguments are equal
+bool is_random (ade::iFunctor* func);
+
 /// Data to pass around when evaluating
 struct DataArg
 {
@@ -6,11 +6,14 @@
 /// Define evaluation visitor to evaluate the root of an equation graph
 ///
 
+#include <unordered_map>
+
 #include "ade/traveler.hpp"
 
 #include "llo/generated/opmap.hpp"
 
 #include "llo/operator.hpp"
+#include "llo/fused.hpp"
 
 #ifndef LLO_EVAL_HPP
 #define LLO_EVAL_HPP
@@ -23,6 +26,8 @@ namespace llo
 /// llo::Sources when possible, otherwise treat native ade::iTensors as zeroes
 /// Additionally, Evaluator attempts to get meta-data from llo::FuncWrapper
 /// before checking native ade::Functor
+/// Results are memoized by tensor, so nodes reachable through multiple
+/// paths are evaluated once and their data shared between parents
 struct Evaluator final : public ade::iTraveler
 {
 	Evaluator (age::_GENERATED_DTYPE dtype) : dtype_(dtype) {}
@@ -30,21 +35,48 @@ struct Evaluator final : public ade::iTraveler
 	/// Implementation of iTraveler
 	void visit (ade::iLeaf* leaf) override
 	{
+		if (reuse(leaf))
+		{
+			return;
+		}
+		if (auto cst = dynamic_cast<Constant*>(leaf))
+		{
+			// consumers broadcast or expand the value as needed
+			out_ = GenericData(ade::Shape(), dtype_);
+			cst->fill(out_);
+			results_.emplace(leaf, out_);
+			return;
+		}
+		if (auto var = dynamic_cast<Variable*>(leaf))
+		{
+			if (var->type_code() == dtype_)
+			{
+				// borrow variable data since evaluation never modifies it
+				out_ = var->share();
+				results_.emplace(leaf, out_);
+				return;
+			}
+		}
 		const char* data = (const char*) leaf->data();
 		age::_GENERATED_DTYPE dtype = (age::_GENERATED_DTYPE) leaf->type_code();
 		const ade::Shape& shape = leaf->shape();
 		out_ = GenericData(shape, dtype_);
 		out_.copyover(data, dtype);
+		results_.emplace(leaf, out_);
 	}
 
 	/// Implementation of iTraveler
 	void visit (ade::iFunctor* func) override
 	{
+		if (reuse(func))
+		{
+			return;
+		}
 		age::_GENERATED_OPCODE opcode = (age::_GENERATED_OPCODE)
 			func->get_opcode().code_;
-		out_ = GenericData(func->shape(), dtype_);
+		GenericData out(func->shape(), dtype_);
 
-		ade::ArgsT children = func->get_children();
+		const ade::ArgsT& children = func->get_children();
 		uint8_t nargs = children.size();
 		DataArgsT argdata = DataArgsT(nargs);
 		if (func->get_opcode().code_ == age::RAND_BINO)
@@ -54,46 +86,91 @@ struct Evaluator final : public ade::iTraveler
 				logs::fatalf("cannot RAND_BINO without exactly 2 arguments: "
 					"using %d arguments", nargs);
 			}
-			Evaluator left_eval(dtype_);
-			children[0].get_tensor()->accept(left_eval);
-			argdata[0] = {
-				left_eval.out_.data_,
-				left_eval.out_.shape_,
-				children[0].get_coorder(),
-				children[0].map_io(),
-			};
-
-			Evaluator right_eval(age::DOUBLE);
-			children[1].get_tensor()->accept(right_eval);
-			argdata[1] = DataArg{
-				right_eval.out_.data_,
-				right_eval.out_.shape_,
-				children[1].get_coorder(),
-				children[1].map_io(),
-			};
+			argdata[0] = evaluate(*this, opcode, children[0]);
+			if (age::DOUBLE == dtype_)
+			{
+				argdata[1] = evaluate(*this, opcode, children[1]);
+			}
+			else
+			{
+				Evaluator right_eval(age::DOUBLE);
+				argdata[1] = evaluate(right_eval, opcode, children[1]);
+			}
 		}
 		else
 		{
 			for (uint8_t i = 0; i < nargs; ++i)
 			{
-				Evaluator evaler(dtype_);
-				children[i].get_tensor()->accept(evaler);
-				argdata[i] = DataArg{
-					evaler.out_.data_,
-					evaler.out_.shape_,
-					children[i].get_coorder(),
-					children[i].map_io(),
-				};
+				argdata[i] = evaluate(*this, opcode, children[i]);
 			}
 		}
 
-		op_exec(opcode, out_.dtype_, out_.data_.get(), out_.shape_, argdata);
+		if (auto fused = dynamic_cast<FusedFunctor*>(func))
+		{
+			fused->eval(out.data_.get(), out.dtype_, argdata);
+		}
+		else
+		{
+			op_exec(opcode, out.dtype_, out.data_.get(), out.shape_, argdata);
+		}
+		out_ = out;
+		results_.emplace(func, out_);
 	}
 
 	/// Output data evaluated upon visiting node
+	/// Constants evaluate to their single value of shape ade::Shape()
 	GenericData out_;
 
+	/// Map of visited tensors to their evaluated data
+	std::unordered_map<ade::iTensor*,GenericData> results_;
+
 private:
+	/// Set out_ to memoized result of tens if tens was already evaluated
+	/// Return true if such result exists, false otherwise
+	bool reuse (ade::iTensor* tens)
+	{
+		auto it = results_.find(tens);
+		if (results_.end() == it)
+		{
+			return false;
+		}
+		out_ = it->second;
+		return true;
+	}
+
+	/// Return argument data of child of consumer evaluated by evaler
+	static DataArg evaluate (Evaluator& evaler,
+		age::_GENERATED_OPCODE consumer, const ade::MappedTensor& child)
+	{
+		child.get_tensor()->accept(evaler);
+		if (auto cst = dynamic_cast<Constant*>(child.get_tensor().get()))
+		{
+			if (can_broadcast(consumer, child))
+			{
+				return DataArg{
+					evaler.out_.data_,
+					evaler.out_.shape_,
+					broadcast,
+					false,
+				};
+			}
+			GenericData full(cst->shape(), evaler.out_.dtype_);
+			cst->fill(full);
+			return DataArg{
+				full.data_,
+				full.shape_,
+				child.get_coorder(),
+				child.map_io(),
+			};
+		}
+		return DataArg{
+			evaler.out_.data_,
+			evaler.out_.shape_,
+			child.get_coorder(),
+			child.map_io(),
+		};
+	}
+
 	/// Output type when evaluating data
 	age::_GENERATED_DTYPE dtype_;
 };
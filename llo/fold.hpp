@@ -0,0 +1,44 @@
+///
+/// fold.hpp
+/// llo
+///
+/// Purpose:
+/// Define llo constant folding
+///
+
+#include "opt/fold.hpp"
+
+#include "llo/data.hpp"
+
+#ifndef LLO_FOLD_HPP
+#define LLO_FOLD_HPP
+
+namespace llo
+{
+
+/// Return Variable of tens if it is a constant Variable or a constant
+/// LazyVariable already fetched, otherwise return null
+/// Unfetched LazyVariables stay unfetched, so optimizations reading
+/// the values of constants skip them
+Variable* constant_variable (ade::iTensor* tens);
+
+/// Return true if leaf is a Constant, a constant Variable or
+/// a constant LazyVariable, without fetching the data of the latter
+bool is_constant (ade::iLeaf* leaf);
+
+/// Return true if tens is a Constant or constant_variable with every
+/// element equal to value when converted to double
+bool is_constant_value (ade::iTensor* tens, double value);
+
+/// Return graph of root where every subgraph of constant leaves is
+/// evaluated ahead of time and replaced by a constant Variable of dtype,
+/// or by a Constant if the subgraph applies only elementwise operations
+/// to Constants, so its single value is evaluated once
+/// Folded data is computed as dtype, so the result matches root
+/// only when evaluated as dtype
+ade::TensptrT const_fold (ade::TensptrT root,
+	age::_GENERATED_DTYPE dtype = age::DOUBLE);
+
+}
+
+#endif // LLO_FOLD_HPP
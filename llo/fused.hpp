@@ -0,0 +1,120 @@
+///
+/// fused.hpp
+/// llo
+///
+/// Purpose:
+/// Define functor evaluating a chain of elementwise operations
+/// in a single pass without materializing intermediates
+///
+
+#include "opt/fuse.hpp"
+
+#include "llo/generated/codes.hpp"
+
+#include "llo/data.hpp"
+
+#ifndef LLO_FUSED_HPP
+#define LLO_FUSED_HPP
+
+namespace llo
+{
+
+/// Number of elements of every intermediate buffer evaluated by FusedFunctor
+/// Blocks are small enough to stay in cache between steps
+const size_t fused_block = 240;
+
+/// Elementwise operation of FusedFunctor
+struct FusedStep final
+{
+	/// Operation applied to values at indices args_
+	age::_GENERATED_OPCODE opcode_;
+
+	/// Indices of values read by the step, where values [0, ninputs)
+	/// are inputs of the fused functor and value ninputs + i is
+	/// the output of step i
+	std::vector<size_t> args_;
+};
+
+/// Functor replacing a region of identity-mapped elementwise functors
+/// Evaluating the functor applies every step to one block of elements at a
+/// time, so intermediate results never exceed a few blocks of memory
+/// Fused functors only support evaluation, graphs containing them
+/// cannot be derived or serialized
+struct FusedFunctor final : public ade::iFunctor
+{
+	FusedFunctor (ade::Shape shape, ade::TensT inputs,
+		std::vector<FusedStep> steps) : shape_(shape), steps_(steps)
+	{
+		if (steps_.empty())
+		{
+			logs::fatal("cannot fuse without operations");
+		}
+		for (ade::TensptrT& input : inputs)
+		{
+			args_.push_back(ade::identity_map(input));
+		}
+	}
+
+	/// Implementation of iTensor
+	const ade::Shape& shape (void) const override
+	{
+		return shape_;
+	}
+
+	/// Implementation of iTensor
+	std::string to_string (void) const override
+	{
+		std::vector<std::string> names;
+		for (const FusedStep& step : steps_)
+		{
+			names.push_back(age::name_op(step.opcode_));
+		}
+		return "FUSED" + fmts::to_string(names.begin(), names.end());
+	}
+
+	/// Implementation of iFunctor
+	ade::Opcode get_opcode (void) const override
+	{
+		return ade::Opcode{"FUSED", age::BAD_OP};
+	}
+
+	/// Implementation of iFunctor
+	const ade::ArgsT& get_children (void) const override
+	{
+		return args_;
+	}
+
+	/// Return steps in order of evaluation, the last step produces output
+	const std::vector<FusedStep>& get_steps (void) const
+	{
+		return steps_;
+	}
+
+	/// Write all elements of the fused output as dtype to out given
+	/// inputs evaluated as dtype (parallel to children)
+	void eval (char* out, age::_GENERATED_DTYPE dtype,
+		const DataArgsT& inputs) const;
+
+private:
+	ade::Shape shape_;
+
+	ade::ArgsT args_;
+
+	std::vector<FusedStep> steps_;
+};
+
+/// Return true if opcode is elementwise and can be evaluated in blocks
+bool is_fusable (age::_GENERATED_OPCODE opcode);
+
+/// Return func rebuilt over args, FusedFunctors keep their steps and
+/// only accept identity-mapped args, other functors keep their opcode
+/// Optimization passes rebuild with this so they can run after fuse
+ade::TensptrT rebuild (ade::iFunctor* func, ade::ArgsT args);
+
+/// Return graph of root where every maximal region of fusable
+/// identity-mapped functors is replaced by one FusedFunctor
+ade::TensptrT fuse (ade::TensptrT root);
+
+}
+
+#endif // LLO_FUSED_HPP
@@ -36,8 +36,23 @@ ade::TensptrT reduce (ade::Opcode opcode, ade::TensptrT tens, uint8_t dim);
 ade::TensptrT matmul (ade::TensptrT a, ade::TensptrT b);
 
 /// Return convolution operation on img with kernel
+/// img has shape [in_channels, in_height, in_width, nbatch],
+/// kernel has shape [out_channels, in_channels, kernel_height, kernel_width]
+/// and output has shape [out_channels, out_height, out_width, nbatch],
+/// where out_height is in_height - 2 * floor(kernel_height / 2)
+/// (similarly for width)
 ade::TensptrT convolution (ade::TensptrT img, ade::TensptrT kernel);
 
+/// Return gradient of convolution with respect to image of imgshape,
+/// given kernel and gradient grad with respect to convolution output
+ade::TensptrT convolution_image_grad (ade::Shape imgshape,
+	ade::TensptrT kernel, ade::TensptrT grad);
+
+/// Return gradient of convolution with respect to kernel of kernelshape,
+/// given img and gradient grad with respect to convolution output
+ade::TensptrT convolution_kernel_grad (ade::Shape kernelshape,
+	ade::TensptrT img, ade::TensptrT grad);
+
 }
 
 #endif // LLO_HELPER_HPP
@@ -6,6 +6,14 @@
 /// Collectively include all llo header files
 ///
 
+#include "llo/compose.hpp"
+#include "llo/cse.hpp"
 #include "llo/eval.hpp"
+#include "llo/fold.hpp"
+#include "llo/fused.hpp"
+#include "llo/mmap.hpp"
+#include "llo/plan.hpp"
 #include "llo/serialize.hpp"
+#include "llo/session.hpp"
+#include "llo/simplify.hpp"
 #include "llo/zprune.hpp"
@@ -0,0 +1,43 @@
+///
+/// mmap.hpp
+/// llo
+///
+/// Purpose:
+/// Define variables backed by memory mapped regions of data files
+///
+
+#include "llo/data.hpp"
+
+#ifndef LLO_MMAP_HPP
+#define LLO_MMAP_HPP
+
+namespace llo
+{
+
+/// Return data of shape and dtype mapped from path starting at offset bytes
+/// Pages are read lazily on first access and, when not copy_on_write,
+/// shared through the page cache with every process mapping the same file
+/// Copy on write mappings are private, so writes never reach the file
+/// The region is unmapped once no variable or evaluation uses the data
+GenericData map_data (std::string path, size_t offset,
+	ade::Shape shape, age::_GENERATED_DTYPE dtype, bool copy_on_write = false);
+
+/// Return new variable of data mapped by map_data and labelled by label
+/// Assigning to a copy on write variable writes to its private pages,
+/// otherwise assignment replaces the mapping with the variable's own buffer
+VarptrT map_variable (std::string path, size_t offset,
+	ade::Shape shape, age::_GENERATED_DTYPE dtype,
+	std::string label = "", bool copy_on_write = false);
+
+/// Return variable of data marshalled by serialize at offset of file at
+/// path, marked constant if the data never changes
+/// Data is mapped in place when its bytes are readable as is, that is
+/// on little endian hosts at offsets aligned to its type, otherwise
+/// data is read from the file and unmarshalled
+ade::TensptrT map_deserialize (std::string path, size_t offset,
+	ade::Shape shape, size_t typecode, std::string label,
+	bool constant = false);
+
+}
+
+#endif // LLO_MMAP_HPP
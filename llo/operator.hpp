@@ -12,7 +12,10 @@
 #include <functional>
 #include <random>
 
+#include "llo/contiguous.hpp"
 #include "llo/data.hpp"
+#include "llo/pool.hpp"
+#include "llo/stride.hpp"
 
 #ifndef LLO_OPERATOR_HPP
 #define LLO_OPERATOR_HPP
@@ -27,19 +30,34 @@ using EngineT = std::default_random_engine;
 EngineT& get_engine (void);
 
 /// Generic unary operation assuming identity mapping
-template <typename T>
-void unary (T* out, ade::Shape& outshape,
-	VecRef<T> in, std::function<T(const T&)> f)
+/// Maps supported by StrideIndexer are walked without calling forward
+/// Identity and pull mappings are split across threads via parallel_for,
+/// push mappings run serially since inputs can write to the same output
+/// F is any callable taking const T& and returning a value assignable to T,
+/// so operations are inlined into the element loops
+template <typename T, typename F>
+void unary (T* out, ade::Shape& outshape, VecRef<T> in, F f)
 {
 	if (in.mapper == ade::identity)
 	{
-		for (ade::NElemT i = 0, n = in.shape.n_elems(); i < n; ++i)
+		parallel_for(in.shape.n_elems(),
+		[&](size_t begin, size_t end)
 		{
-			out[i] = f(in.data[i]);
-		}
+			contiguous_unary(out + begin, in.data + begin, end - begin, f);
+		});
 	}
 	else if (in.push)
 	{
+		StrideIndexer indexer(*in.mapper, in.shape, outshape);
+		if (indexer.valid_)
+		{
+			stride_walk<1>(in.shape, 0, in.shape.n_elems(), {&indexer},
+			[&](ade::NElemT i, const std::array<ade::NElemT,1>& mapped)
+			{
+				out[mapped[0]] = f(in.data[i]);
+			});
+			return;
+		}
 		ade::CoordT coord;
 		for (ade::NElemT i = 0, n = in.shape.n_elems(); i < n; ++i)
 		{
@@ -50,13 +68,27 @@ void unary (T* out, ade::Shape& outshape,
 	}
 	else
 	{
-		ade::CoordT coord;
-		for (ade::NElemT i = 0, n = outshape.n_elems(); i < n; ++i)
+		StrideIndexer indexer(*in.mapper, outshape, in.shape);
+		parallel_for(outshape.n_elems(),
+		[&](size_t begin, size_t end)
 		{
-			in.mapper->forward(coord.begin(),
-				ade::coordinate(outshape, i).begin());
-			out[i] = f(in.data[ade::index(in.shape, coord)]);
-		}
+			if (indexer.valid_)
+			{
+				stride_walk<1>(outshape, begin, end, {&indexer},
+				[&](ade::NElemT i, const std::array<ade::NElemT,1>& mapped)
+				{
+					out[i] = f(in.data[mapped[0]]);
+				});
+				return;
+			}
+			ade::CoordT coord;
+			for (ade::NElemT i = begin; i < end; ++i)
+			{
+				in.mapper->forward(coord.begin(),
+					ade::coordinate(outshape, i).begin());
+				out[i] = f(in.data[ade::index(in.shape, coord)]);
+			}
+		});
 	}
 }
 
@@ -65,7 +97,7 @@ void unary (T* out, ade::Shape& outshape,
 template <typename T>
 void abs (T* out, VecRef<T> in)
 {
-	unary<T>(out, in.shape, in, [](const T& src) { return std::abs(src); });
+	unary<T>(out, in.shape, in, AbsOp());
 }
 
 template <>
@@ -85,7 +117,7 @@ void abs<uint64_t> (uint64_t* out, VecRef<uint64_t> in);
 template <typename T>
 void neg (T* out, VecRef<T> in)
 {
-	unary<T>(out, in.shape, in, [](const T& src) { return -src; });
+	unary<T>(out, in.shape, in, NegOp());
 }
 
 template <>
@@ -113,7 +145,7 @@ void bit_not (T* out, VecRef<T> in)
 template <typename T>
 void sin (T* out, VecRef<T> in)
 {
-	unary<T>(out, in.shape, in, [](const T& src) { return std::sin(src); });
+	unary<T>(out, in.shape, in, SinOp());
 }
 
 /// Given reference to output array, and input vector ref,
@@ -121,7 +153,7 @@ void sin (T* out, VecRef<T> in)
 template <typename T>
 void cos (T* out, VecRef<T> in)
 {
-	unary<T>(out, in.shape, in, [](const T& src) { return std::cos(src); });
+	unary<T>(out, in.shape, in, CosOp());
 }
 
 /// Given reference to output array, and input vector ref,
@@ -137,7 +169,7 @@ void tan (T* out, VecRef<T> in)
 template <typename T>
 void exp (T* out, VecRef<T> in)
 {
-	unary<T>(out, in.shape, in, [](const T& src) { return std::exp(src); });
+	unary<T>(out, in.shape, in, ExpOp());
 }
 
 /// Given reference to output array, and input vector ref,
@@ -145,7 +177,7 @@ void exp (T* out, VecRef<T> in)
 template <typename T>
 void log (T* out, VecRef<T> in)
 {
-	unary<T>(out, in.shape, in, [](const T& src) { return std::log(src); });
+	unary<T>(out, in.shape, in, LogOp());
 }
 
 /// Given reference to output array, and input vector ref,
@@ -153,7 +185,7 @@ void log (T* out, VecRef<T> in)
 template <typename T>
 void sqrt (T* out, VecRef<T> in)
 {
-	unary<T>(out, in.shape, in, [](const T& src) { return std::sqrt(src); });
+	unary<T>(out, in.shape, in, SqrtOp());
 }
 
 /// Given reference to output array, and input vector ref,
@@ -165,26 +197,67 @@ void round (T* out, VecRef<T> in)
 }
 
 /// Generic binary operation assuming identity mapping
-template <typename OUT, typename ATYPE, typename BTYPE>
-void binary (OUT* out, ade::Shape& outshape, VecRef<ATYPE> a, VecRef<BTYPE> b,
-	std::function<OUT(const ATYPE&,const BTYPE&)> f)
+/// Maps supported by StrideIndexer are walked without calling forward
+/// Pull mappings are split across threads via parallel_for unless
+/// parallel is false, push mappings always run serially
+/// Random operators pass false since they share one engine
+/// F is any callable taking const ATYPE& and const BTYPE&,
+/// and returning a value assignable to OUT
+template <typename OUT, typename ATYPE, typename BTYPE, typename F>
+void binary (OUT* out, ade::Shape& outshape,
+	VecRef<ATYPE> a, VecRef<BTYPE> b, F f, bool parallel = true)
 {
+	auto loop = [parallel](size_t n, std::function<void(size_t,size_t)> g)
+	{
+		if (parallel)
+		{
+			parallel_for(n, g);
+		}
+		else
+		{
+			g(0, n);
+		}
+	};
+	if (a.mapper == ade::identity && b.mapper == ade::identity)
+	{
+		loop(outshape.n_elems(),
+		[&](size_t begin, size_t end)
+		{
+			contiguous_binary(out + begin,
+				a.data + begin, b.data + begin, end - begin, f);
+		});
+	}
 	// avoid tmpdata by checking if it's needed
 	// tmpdata not needed if neither a nor b are pushing
-	if (false == (a.push || b.push))
+	else if (false == (a.push || b.push))
 	{
-		ade::CoordT coord;
-		ade::CoordT acoord;
-		ade::CoordT bcoord;
-		for (ade::NElemT i = 0, n = outshape.n_elems(); i < n; ++i)
+		StrideIndexer aindexer(*a.mapper, outshape, a.shape);
+		StrideIndexer bindexer(*b.mapper, outshape, b.shape);
+		loop(outshape.n_elems(),
+		[&](size_t begin, size_t end)
 		{
-			coord = ade::coordinate(outshape, i);
-			a.mapper->forward(acoord.begin(), coord.begin());
-			b.mapper->forward(bcoord.begin(), coord.begin());
-			out[i] = f(
-				a.data[ade::index(a.shape, acoord)],
-				b.data[ade::index(b.shape, bcoord)]);
-		}
+			if (aindexer.valid_ && bindexer.valid_)
+			{
+				stride_walk<2>(outshape, begin, end, {&aindexer, &bindexer},
+				[&](ade::NElemT i, const std::array<ade::NElemT,2>& mapped)
+				{
+					out[i] = f(a.data[mapped[0]], b.data[mapped[1]]);
+				});
+				return;
+			}
+			ade::CoordT coord;
+			ade::CoordT acoord;
+			ade::CoordT bcoord;
+			for (ade::NElemT i = begin; i < end; ++i)
+			{
+				coord = ade::coordinate(outshape, i);
+				a.mapper->forward(acoord.begin(), coord.begin());
+				b.mapper->forward(bcoord.begin(), coord.begin());
+				out[i] = f(
+					a.data[ade::index(a.shape, acoord)],
+					b.data[ade::index(b.shape, bcoord)]);
+			}
+		});
 	}
 	else // a.push || b.push
 	{
@@ -192,40 +265,94 @@ void binary (OUT* out, ade::Shape& outshape, VecRef<ATYPE> a, VecRef<BTYPE> b,
 		ade::CoordT coord;
 		if (a.push)
 		{
-			for (ade::NElemT i = 0, n = a.shape.n_elems(); i < n; ++i)
+			StrideIndexer indexer(*a.mapper, a.shape, outshape);
+			if (indexer.valid_)
 			{
-				a.mapper->forward(coord.begin(),
-					ade::coordinate(a.shape, i).begin());
-				tmpdata[ade::index(outshape, coord)] = a.data[i];
+				stride_walk<1>(a.shape, 0, a.shape.n_elems(), {&indexer},
+				[&](ade::NElemT i, const std::array<ade::NElemT,1>& mapped)
+				{
+					tmpdata[mapped[0]] = a.data[i];
+				});
+			}
+			else
+			{
+				for (ade::NElemT i = 0, n = a.shape.n_elems(); i < n; ++i)
+				{
+					a.mapper->forward(coord.begin(),
+						ade::coordinate(a.shape, i).begin());
+					tmpdata[ade::index(outshape, coord)] = a.data[i];
+				}
 			}
 		}
 		else
 		{
-			for (ade::NElemT i = 0, n = outshape.n_elems(); i < n; ++i)
+			StrideIndexer indexer(*a.mapper, outshape, a.shape);
+			loop(outshape.n_elems(),
+			[&](size_t begin, size_t end)
 			{
-				a.mapper->forward(coord.begin(),
-					ade::coordinate(outshape, i).begin());
-				tmpdata[i] = a.data[ade::index(a.shape, coord)];
-			}
+				if (indexer.valid_)
+				{
+					stride_walk<1>(outshape, begin, end, {&indexer},
+					[&](ade::NElemT i, const std::array<ade::NElemT,1>& mapped)
+					{
+						tmpdata[i] = a.data[mapped[0]];
+					});
+					return;
+				}
+				ade::CoordT coord;
+				for (ade::NElemT i = begin; i < end; ++i)
+				{
+					a.mapper->forward(coord.begin(),
+						ade::coordinate(outshape, i).begin());
+					tmpdata[i] = a.data[ade::index(a.shape, coord)];
+				}
+			});
 		}
 		if (b.push)
 		{
-			for (ade::NElemT i = 0, n = b.shape.n_elems(); i < n; ++i)
+			StrideIndexer indexer(*b.mapper, b.shape, outshape);
+			if (indexer.valid_)
+			{
+				stride_walk<1>(b.shape, 0, b.shape.n_elems(), {&indexer},
+				[&](ade::NElemT i, const std::array<ade::NElemT,1>& mapped)
+				{
+					out[mapped[0]] = f(tmpdata[mapped[0]], b.data[i]);
+				});
+			}
+			else
 			{
-				b.mapper->forward(coord.begin(),
-					ade::coordinate(b.shape, i).begin());
-				ade::NElemT outidx = ade::index(outshape, coord);
-				out[outidx] = f(tmpdata[outidx], b.data[i]);
+				for (ade::NElemT i = 0, n = b.shape.n_elems(); i < n; ++i)
+				{
+					b.mapper->forward(coord.begin(),
+						ade::coordinate(b.shape, i).begin());
+					ade::NElemT outidx = ade::index(outshape, coord);
+					out[outidx] = f(tmpdata[outidx], b.data[i]);
+				}
 			}
 		}
 		else
 		{
-			for (ade::NElemT i = 0, n = outshape.n_elems(); i < n; ++i)
+			StrideIndexer indexer(*b.mapper, outshape, b.shape);
+			loop(outshape.n_elems(),
+			[&](size_t begin, size_t end)
 			{
-				b.mapper->forward(coord.begin(),
-					ade::coordinate(outshape, i).begin());
-				out[i] = f(tmpdata[i], b.data[ade::index(b.shape, coord)]);
-			}
+				if (indexer.valid_)
+				{
+					stride_walk<1>(outshape, begin, end, {&indexer},
+					[&](ade::NElemT i, const std::array<ade::NElemT,1>& mapped)
+					{
+						out[i] = f(tmpdata[i], b.data[mapped[0]]);
+					});
+					return;
+				}
+				ade::CoordT coord;
+				for (ade::NElemT i = begin; i < end; ++i)
+				{
+					b.mapper->forward(coord.begin(),
+						ade::coordinate(outshape, i).begin());
+					out[i] = f(tmpdata[i], b.data[ade::index(b.shape, coord)]);
+				}
+			});
 		}
 	}
 }
@@ -236,8 +363,7 @@ void binary (OUT* out, ade::Shape& outshape, VecRef<ATYPE> a, VecRef<BTYPE> b,
 template <typename T>
 void pow (T* out, ade::Shape& outshape, VecRef<T> a, VecRef<T> b)
 {
-	binary<T,T,T>(out, outshape, a, b,
-	[](const T& b, const T& x) { return std::pow(b, x); });
+	binary<T,T,T>(out, outshape, a, b, PowOp());
 }
 
 /// Given arguments a, and b, for every pair of mapped elements sharing the
@@ -246,8 +372,7 @@ void pow (T* out, ade::Shape& outshape, VecRef<T> a, VecRef<T> b)
 template <typename T>
 void sub (T* out, ade::Shape& outshape, VecRef<T> a, VecRef<T> b)
 {
-	binary<T,T,T>(out, outshape, a, b,
-	[](const T& a, const T& b) { return a - b; });
+	binary<T,T,T>(out, outshape, a, b, SubOp());
 }
 
 /// Given arguments a, and b, for every pair of mapped elements sharing the
@@ -256,8 +381,7 @@ void sub (T* out, ade::Shape& outshape, VecRef<T> a, VecRef<T> b)
 template <typename T>
 void div (T* out, ade::Shape& outshape, VecRef<T> a, VecRef<T> b)
 {
-	binary<T,T,T>(out, outshape, a, b,
-	[](const T& a, const T& b) { return a / b; });
+	binary<T,T,T>(out, outshape, a, b, DivOp());
 }
 
 /// Given arguments a, and b, for every pair of mapped elements sharing the
@@ -266,8 +390,7 @@ void div (T* out, ade::Shape& outshape, VecRef<T> a, VecRef<T> b)
 template <typename T>
 void eq (T* out, ade::Shape& outshape, VecRef<T> a, VecRef<T> b)
 {
-	binary<T,T,T>(out, outshape, a, b,
-	[](const T& a, const T& b) { return a == b; });
+	binary<T,T,T>(out, outshape, a, b, EqOp());
 }
 
 /// Given arguments a, and b, for every pair of mapped elements sharing the
@@ -276,8 +399,7 @@ void eq (T* out, ade::Shape& outshape, VecRef<T> a, VecRef<T> b)
 template <typename T>
 void neq (T* out, ade::Shape& outshape, VecRef<T> a, VecRef<T> b)
 {
-	binary<T,T,T>(out, outshape, a, b,
-	[](const T& a, const T& b) { return a != b; });
+	binary<T,T,T>(out, outshape, a, b, NeqOp());
 }
 
 /// Given arguments a, and b, for every pair of mapped elements sharing the
@@ -286,8 +408,7 @@ void neq (T* out, ade::Shape& outshape, VecRef<T> a, VecRef<T> b)
 template <typename T>
 void lt (T* out, ade::Shape& outshape, VecRef<T> a, VecRef<T> b)
 {
-	binary<T,T,T>(out, outshape, a, b,
-	[](const T& a, const T& b) { return a < b; });
+	binary<T,T,T>(out, outshape, a, b, LtOp());
 }
 
 /// Given arguments a, and b, for every pair of mapped elements sharing the
@@ -296,8 +417,7 @@ void lt (T* out, ade::Shape& outshape, VecRef<T> a, VecRef<T> b)
 template <typename T>
 void gt (T* out, ade::Shape& outshape, VecRef<T> a, VecRef<T> b)
 {
-	binary<T,T,T>(out, outshape, a, b,
-	[](const T& a, const T& b) { return a > b; });
+	binary<T,T,T>(out, outshape, a, b, GtOp());
 }
 
 /// Given arguments a, and b, for every pair of mapped elements sharing the
@@ -311,7 +431,7 @@ void rand_binom (T* out, ade::Shape& outshape, VecRef<T> a, VecRef<double> b)
 	{
 		std::binomial_distribution<T> dist(a, b);
 		return dist(get_engine());
-	});
+	}, false);
 }
 
 template <>
@@ -334,7 +454,7 @@ void rand_uniform (T* out,
 	{
 		std::uniform_int_distribution<T> dist(a, b);
 		return dist(get_engine());
-	});
+	}, false);
 }
 
 template <>
@@ -362,42 +482,151 @@ template <>
 void rand_normal<float> (float* out,
 	ade::Shape& outshape, VecRef<float> a, VecRef<float> b);
 
+/// Return number of parts to split nin inputs pushed to nout outputs into,
+/// where every part but the first accumulates into its own copy of the
+/// outputs, or 1 if the inputs are too few to split
+/// Parts are limited so their copies take no more memory than the inputs
+inline size_t push_parts (size_t nin, size_t nout)
+{
+	const ParallelConfig& config = get_parallel_config();
+	if (nin < std::max(config.threshold_, (size_t) 1))
+	{
+		return 1;
+	}
+	size_t nparts = std::min(get_pool().nthreads() + 1,
+		nin / std::max(config.grain_, (size_t) 1));
+	nparts = std::min(nparts, nin / std::max(nout, (size_t) 1) + 1);
+	return std::max(nparts, (size_t) 1);
+}
+
 /// Generic n-nary operation
-template <typename T>
-void nnary (T* out, ade::Shape& outshape, std::vector<VecRef<T>> args,
-	std::function<void(T&, const T&)> acc)
+/// Maps supported by StrideIndexer are walked without calling forward
+/// Arguments with pull mappings are split across threads via parallel_for
+/// Arguments with push mappings (such as reductions) split their inputs
+/// across threads into partial outputs, which are then accumulated into
+/// the output in input order, so floating point sums only differ from
+/// a serial sum by where partial sums are grouped
+/// Acc is any callable taking T& accumulator and const T& value
+template <typename T, typename Acc>
+void nnary (T* out, ade::Shape& outshape,
+	std::vector<VecRef<T>> args, Acc acc)
 {
 	ade::NElemT nout = outshape.n_elems();
-	bool visited[nout];
-	std::memset(visited, false, nout);
-	ade::CoordT coord;
+	if (false == args.empty() && std::all_of(args.begin(), args.end(),
+		[](VecRef<T>& arg) { return arg.mapper == ade::identity; }))
+	{
+		parallel_for(nout,
+		[&](size_t begin, size_t end)
+		{
+			std::copy(args[0].data + begin, args[0].data + end, out + begin);
+			for (size_t i = 1, n = args.size(); i < n; ++i)
+			{
+				contiguous_acc(out + begin,
+					args[i].data + begin, end - begin, acc);
+			}
+		});
+		return;
+	}
+	// char rather than bool so threads can write neighboring flags
+	std::vector<char> visited(nout, false);
 	for (VecRef<T>& arg : args)
 	{
 		if (arg.push)
 		{
-			for (ade::NElemT i = 0, n = arg.shape.n_elems(); i < n; ++i)
+			StrideIndexer indexer(*arg.mapper, arg.shape, outshape);
+			// accumulate inputs [begin, end) into pout flagged by pvisited
+			auto walk = [&](T* pout, char* pvisited,
+				ade::NElemT begin, ade::NElemT end)
 			{
-				arg.mapper->forward(coord.begin(),
-					ade::coordinate(arg.shape, i).begin());
-				ade::NElemT outidx = ade::index(outshape, coord);
-				if (visited[outidx])
+				auto visit = [&](ade::NElemT i, ade::NElemT outidx)
+				{
+					if (pvisited[outidx])
+					{
+						acc(pout[outidx], arg.data[i]);
+					}
+					else
+					{
+						pout[outidx] = arg.data[i];
+						pvisited[outidx] = true;
+					}
+				};
+				if (indexer.valid_)
 				{
-					acc(out[outidx], arg.data[i]);
+					stride_walk<1>(arg.shape, begin, end, {&indexer},
+					[&](ade::NElemT i, const std::array<ade::NElemT,1>& mapped)
+					{
+						visit(i, mapped[0]);
+					});
+					return;
 				}
-				else
+				ade::CoordT coord;
+				for (ade::NElemT i = begin; i < end; ++i)
 				{
-					out[outidx] = arg.data[i];
-					visited[outidx] = true;
+					arg.mapper->forward(coord.begin(),
+						ade::coordinate(arg.shape, i).begin());
+					visit(i, ade::index(outshape, coord));
 				}
+			};
+			ade::NElemT nin = arg.shape.n_elems();
+			size_t nparts = push_parts(nin, nout);
+			if (nparts < 2)
+			{
+				walk(out, &visited[0], 0, nin);
+				continue;
 			}
+			// the first part accumulates into out, later parts into
+			// partial outputs combined into out in order of parts
+			size_t part = (nin + nparts - 1) / nparts;
+			std::vector<std::vector<T>> pouts(nparts - 1,
+				std::vector<T>(nout));
+			std::vector<std::vector<char>> pvisiteds(nparts - 1,
+				std::vector<char>(nout, false));
+			parallel_for(nparts, part,
+			[&](size_t begin, size_t end)
+			{
+				for (size_t p = begin; p < end; ++p)
+				{
+					ade::NElemT ibegin = p * part;
+					ade::NElemT iend = std::min<size_t>(ibegin + part, nin);
+					if (0 == p)
+					{
+						walk(out, &visited[0], ibegin, iend);
+					}
+					else
+					{
+						walk(&pouts[p - 1][0], &pvisiteds[p - 1][0],
+							ibegin, iend);
+					}
+				}
+			});
+			parallel_for(nout, nparts - 1,
+			[&](size_t begin, size_t end)
+			{
+				for (size_t p = 0; p < nparts - 1; ++p)
+				{
+					for (size_t i = begin; i < end; ++i)
+					{
+						if (false == pvisiteds[p][i])
+						{
+							continue;
+						}
+						if (visited[i])
+						{
+							acc(out[i], pouts[p][i]);
+						}
+						else
+						{
+							out[i] = pouts[p][i];
+							visited[i] = true;
+						}
+					}
+				}
+			});
 		}
 		else
 		{
-			for (ade::NElemT i = 0, n = outshape.n_elems(); i < n; ++i)
+			auto visit = [&](ade::NElemT i, ade::NElemT inidx)
 			{
-				arg.mapper->forward(coord.begin(),
-					ade::coordinate(outshape, i).begin());
-				ade::NElemT inidx = ade::index(arg.shape, coord);
 				if (visited[i])
 				{
 					acc(out[i], arg.data[inidx]);
@@ -407,19 +636,296 @@ void nnary (T* out, ade::Shape& outshape, std::vector<VecRef<T>> args,
 					out[i] = arg.data[inidx];
 					visited[i] = true;
 				}
-			}
+			};
+			StrideIndexer indexer(*arg.mapper, outshape, arg.shape);
+			parallel_for(nout,
+			[&](size_t begin, size_t end)
+			{
+				if (indexer.valid_)
+				{
+					stride_walk<1>(outshape, begin, end, {&indexer},
+					[&](ade::NElemT i, const std::array<ade::NElemT,1>& mapped)
+					{
+						visit(i, mapped[0]);
+					});
+					return;
+				}
+				ade::CoordT coord;
+				for (ade::NElemT i = begin; i < end; ++i)
+				{
+					arg.mapper->forward(coord.begin(),
+						ade::coordinate(outshape, i).begin());
+					visit(i, ade::index(arg.shape, coord));
+				}
+			});
 		}
 	}
 	// todo: do something/check unvisited elements
 }
 
+/// Rows of a processed together so every loaded row of b is reused
+const size_t gemm_tile_rows = 4;
+
+/// Block of columns of a (rows of b) kept in cache while sweeping rows of a
+const size_t gemm_block_common = 256;
+
+/// Block of output columns kept in cache while sweeping rows of a
+const size_t gemm_block_cols = 512;
+
+/// Given a of shape [C, N] and b of shape [M, C], set out of shape [M, N]
+/// to the matrix product of a and b, where dimension 0 indexes columns
+/// Ignore argument mappers, since MATMUL shapers only describe output shape
+/// Rows of output are split across threads via parallel_for, and each
+/// element accumulates over the common dimension in ascending order
+template <typename T>
+void gemm (T* out, VecRef<T> a, VecRef<T> b)
+{
+	size_t ncommon = a.shape.at(0);
+	size_t nrows = a.shape.at(1);
+	size_t ncols = b.shape.at(0);
+	std::fill(out, out + nrows * ncols, 0);
+	// every row multiplies through all of b
+	parallel_for(nrows, ncols * ncommon,
+	[&](size_t begin, size_t end)
+	{
+		for (size_t kk = 0; kk < ncommon; kk += gemm_block_common)
+		{
+			size_t kend = std::min(kk + gemm_block_common, ncommon);
+			for (size_t jj = 0; jj < ncols; jj += gemm_block_cols)
+			{
+				size_t jend = std::min(jj + gemm_block_cols, ncols);
+				size_t i = begin;
+				for (; i + gemm_tile_rows <= end; i += gemm_tile_rows)
+				{
+					T* out0 = out + i * ncols;
+					T* out1 = out0 + ncols;
+					T* out2 = out1 + ncols;
+					T* out3 = out2 + ncols;
+					const T* arow = a.data + i * ncommon;
+					for (size_t k = kk; k < kend; ++k)
+					{
+						T a0 = arow[k];
+						T a1 = arow[ncommon + k];
+						T a2 = arow[2 * ncommon + k];
+						T a3 = arow[3 * ncommon + k];
+						const T* brow = b.data + k * ncols;
+						for (size_t j = jj; j < jend; ++j)
+						{
+							T bval = brow[j];
+							out0[j] += a0 * bval;
+							out1[j] += a1 * bval;
+							out2[j] += a2 * bval;
+							out3[j] += a3 * bval;
+						}
+					}
+				}
+				for (; i < end; ++i)
+				{
+					T* outrow = out + i * ncols;
+					const T* arow = a.data + i * ncommon;
+					for (size_t k = kk; k < kend; ++k)
+					{
+						T aval = arow[k];
+						const T* brow = b.data + k * ncols;
+						for (size_t j = jj; j < jend; ++j)
+						{
+							outrow[j] += aval * brow[j];
+						}
+					}
+				}
+			}
+		}
+	});
+}
+
+/// Given img of shape [in_channels, in_height, in_width, nbatch] and
+/// kernel of shape [out_channels, in_channels, kernel_height, kernel_width],
+/// set out of shape [out_channels, out_height, out_width, nbatch] to
+/// out[o,y,x,b] = sum_{c,ky,kx} img[c,y+ky,x+kx,b] * kernel[o,c,ky,kx]
+/// Ignore argument mappers, since CONV2D shapers only describe output shape
+/// Output columns (x, b) are split across threads via parallel_for,
+/// and output channels are innermost since they're contiguous in
+/// both kernel and output
+template <typename T>
+void conv2d (T* out, ade::Shape& outshape, VecRef<T> img, VecRef<T> kernel)
+{
+	size_t nchannels = img.shape.at(0);
+	size_t in_height = img.shape.at(1);
+	size_t in_width = img.shape.at(2);
+	size_t nfilters = kernel.shape.at(0);
+	size_t kheight = kernel.shape.at(2);
+	size_t kwidth = kernel.shape.at(3);
+	size_t out_height = outshape.at(1);
+	size_t out_width = outshape.at(2);
+	size_t nbatch = outshape.at(3);
+	std::fill(out, out + outshape.n_elems(), 0);
+	// every column convolves the whole kernel at every output row
+	parallel_for(out_width * nbatch,
+		out_height * kheight * kwidth * nchannels * nfilters,
+	[&](size_t begin, size_t end)
+	{
+		for (size_t col = begin; col < end; ++col)
+		{
+			size_t x = col % out_width;
+			size_t b = col / out_width;
+			for (size_t y = 0; y < out_height; ++y)
+			{
+				T* outpix = out + nfilters * (y + out_height * col);
+				// accumulate in order of kx, ky, c with c fastest
+				for (size_t kx = 0; kx < kwidth; ++kx)
+				{
+					for (size_t ky = 0; ky < kheight; ++ky)
+					{
+						const T* imgpix = img.data + nchannels *
+							(y + ky + in_height * (x + kx + in_width * b));
+						const T* kpix = kernel.data +
+							nfilters * nchannels * (ky + kheight * kx);
+						for (size_t c = 0; c < nchannels; ++c)
+						{
+							T ival = imgpix[c];
+							const T* kfilters = kpix + nfilters * c;
+							for (size_t o = 0; o < nfilters; ++o)
+							{
+								outpix[o] += ival * kfilters[o];
+							}
+						}
+					}
+				}
+			}
+		}
+	});
+}
+
+/// Given grad of shape [out_channels, out_height, out_width, nbatch] and
+/// kernel of shape [out_channels, in_channels, kernel_height, kernel_width],
+/// set out of shape [in_channels, in_height, in_width, nbatch] to
+/// gradient of conv2d with respect to its image
+/// Every image pixel gathers from the output pixels it contributed to,
+/// so image columns (x, b) are split across threads via parallel_for
+template <typename T>
+void conv2d_image_grad (T* out, ade::Shape& outshape,
+	VecRef<T> grad, VecRef<T> kernel)
+{
+	size_t nchannels = outshape.at(0);
+	size_t in_height = outshape.at(1);
+	size_t in_width = outshape.at(2);
+	size_t nbatch = outshape.at(3);
+	size_t nfilters = grad.shape.at(0);
+	size_t out_height = grad.shape.at(1);
+	size_t out_width = grad.shape.at(2);
+	size_t kheight = kernel.shape.at(2);
+	size_t kwidth = kernel.shape.at(3);
+	std::fill(out, out + outshape.n_elems(), 0);
+	// every column gathers from at most the whole kernel at every image row
+	parallel_for(in_width * nbatch,
+		in_height * kheight * kwidth * nchannels * nfilters,
+	[&](size_t begin, size_t end)
+	{
+		for (size_t col = begin; col < end; ++col)
+		{
+			size_t ix = col % in_width;
+			size_t b = col / in_width;
+			for (size_t iy = 0; iy < in_height; ++iy)
+			{
+				T* outpix = out + nchannels * (iy + in_height * col);
+				for (size_t kx = 0; kx < kwidth && kx <= ix; ++kx)
+				{
+					size_t x = ix - kx;
+					if (x >= out_width)
+					{
+						continue;
+					}
+					for (size_t ky = 0; ky < kheight && ky <= iy; ++ky)
+					{
+						size_t y = iy - ky;
+						if (y >= out_height)
+						{
+							continue;
+						}
+						const T* gpix = grad.data + nfilters *
+							(y + out_height * (x + out_width * b));
+						const T* kpix = kernel.data +
+							nfilters * nchannels * (ky + kheight * kx);
+						for (size_t c = 0; c < nchannels; ++c)
+						{
+							const T* kfilters = kpix + nfilters * c;
+							T acc = 0;
+							for (size_t o = 0; o < nfilters; ++o)
+							{
+								acc += gpix[o] * kfilters[o];
+							}
+							outpix[c] += acc;
+						}
+					}
+				}
+			}
+		}
+	});
+}
+
+/// Given img of shape [in_channels, in_height, in_width, nbatch] and
+/// grad of shape [out_channels, out_height, out_width, nbatch],
+/// set out of shape [out_channels, in_channels, kernel_height, kernel_width]
+/// to gradient of conv2d with respect to its kernel
+/// Kernel height and width are only known from outshape, since
+/// out_height only determines kernel_height up to its parity
+/// Kernel pixels (ky, kx) are split across threads via parallel_for
+template <typename T>
+void conv2d_kernel_grad (T* out, ade::Shape& outshape,
+	VecRef<T> img, VecRef<T> grad)
+{
+	size_t nfilters = outshape.at(0);
+	size_t nchannels = outshape.at(1);
+	size_t kheight = outshape.at(2);
+	size_t kwidth = outshape.at(3);
+	size_t in_height = img.shape.at(1);
+	size_t in_width = img.shape.at(2);
+	size_t nbatch = img.shape.at(3);
+	size_t out_height = grad.shape.at(1);
+	size_t out_width = grad.shape.at(2);
+	std::fill(out, out + outshape.n_elems(), 0);
+	// every kernel pixel sums over all output pixels of every batch
+	parallel_for(kheight * kwidth,
+		nbatch * out_width * out_height * nchannels * nfilters,
+	[&](size_t begin, size_t end)
+	{
+		for (size_t kpix = begin; kpix < end; ++kpix)
+		{
+			size_t ky = kpix % kheight;
+			size_t kx = kpix / kheight;
+			T* outk = out + nfilters * nchannels * kpix;
+			for (size_t b = 0; b < nbatch; ++b)
+			{
+				for (size_t x = 0; x < out_width; ++x)
+				{
+					for (size_t y = 0; y < out_height; ++y)
+					{
+						const T* gpix = grad.data + nfilters *
+							(y + out_height * (x + out_width * b));
+						const T* imgpix = img.data + nchannels *
+							(y + ky + in_height * (x + kx + in_width * b));
+						for (size_t c = 0; c < nchannels; ++c)
+						{
+							T ival = imgpix[c];
+							T* outfilters = outk + nfilters * c;
+							for (size_t o = 0; o < nfilters; ++o)
+							{
+								outfilters[o] += gpix[o] * ival;
+							}
+						}
+					}
+				}
+			}
+		}
+	});
+}
+
 /// Given arguments, for every mapped index i in range [0:max_nelems],
 /// sum all elements for all arguments
 template <typename T>
 void add (T* out, ade::Shape& outshape, std::vector<VecRef<T>> args)
 {
-	nnary<T>(out, outshape, args,
-		[](T& out, const T& val) { out += val; });
+	nnary<T>(out, outshape, args, AddAcc());
 }
 
 /// Given arguments, for every mapped index i in range [0:max_nelems],
@@ -427,8 +933,7 @@ void add (T* out, ade::Shape& outshape, std::vector<VecRef<T>> args)
 template <typename T>
 void mul (T* out, ade::Shape& outshape, std::vector<VecRef<T>> args)
 {
-	nnary<T>(out, outshape, args,
-		[](T& out, const T& val) { out *= val; });
+	nnary<T>(out, outshape, args, MulAcc());
 }
 
 /// Given arguments, for every mapped index i in range [0:max_nelems],
@@ -436,8 +941,7 @@ void mul (T* out, ade::Shape& outshape, std::vector<VecRef<T>> args)
 template <typename T>
 void min (T* out, ade::Shape& outshape, std::vector<VecRef<T>> args)
 {
-	nnary<T>(out, outshape, args,
-		[](T& out, const T& val) { out = std::min(out, val); });
+	nnary<T>(out, outshape, args, MinAcc());
 }
 
 /// Given arguments, for every mapped index i in range [0:max_nelems],
@@ -445,8 +949,7 @@ void min (T* out, ade::Shape& outshape, std::vector<VecRef<T>> args)
 template <typename T>
 void max (T* out, ade::Shape& outshape, std::vector<VecRef<T>> args)
 {
-	nnary<T>(out, outshape, args,
-		[](T& out, const T& val) { out = std::max(out, val); });
+	nnary<T>(out, outshape, args, MaxAcc());
 }
 
 }
@@ -0,0 +1,112 @@
+///
+/// plan.hpp
+/// llo
+///
+/// Purpose:
+/// Define execution plan compiled once from an equation graph and
+/// replayed on every evaluation without traversing the graph
+///
+
+#include <map>
+#include <tuple>
+
+#include "llo/eval.hpp"
+#include "llo/pool.hpp"
+
+#ifndef LLO_PLAN_HPP
+#define LLO_PLAN_HPP
+
+namespace llo
+{
+
+/// Single step of a Plan writing to one buffer slot
+struct Instruction final
+{
+	/// Leaf copied into out_ slot, nullptr if instruction is an operation
+	ade::iLeaf* leaf_;
+
+	/// Operation applied to args_ if leaf_ and fused_ are nullptr
+	age::_GENERATED_OPCODE opcode_;
+
+	/// Fused functor evaluated instead of opcode_ if not nullptr
+	const FusedFunctor* fused_;
+
+	/// Index of slot written by this instruction
+	size_t out_;
+
+	/// Indices of slots read by this instruction (parallel to args_)
+	std::vector<size_t> in_;
+
+	/// Argument meta-data resolved at compile time,
+	/// only data_ is updated on every run
+	DataArgsT args_;
+};
+
+/// Flattened, topologically sorted list of instructions
+/// evaluating root tensor according to dtype
+/// Intermediate slots live in a single arena preallocated by the plan,
+/// where slots whose lifetimes don't overlap share the same bytes
+struct Plan final
+{
+	Plan (ade::TensptrT root, age::_GENERATED_DTYPE dtype);
+
+	/// Execute every instruction in order and return data of root
+	/// Root data is freshly allocated, so it outlives subsequent runs,
+	/// but run is not reentrant since all runs share the same arena
+	GenericData run (void);
+
+	/// Execute instructions on pool as soon as their inputs are ready,
+	/// so independent subgraphs are evaluated concurrently, and return
+	/// data of root; the calling thread helps execute until root is done
+	/// Intermediate data is allocated per instruction instead of using
+	/// the arena, since concurrent instructions can't share bytes planned
+	/// for sequential execution, and is released once every consumer has
+	/// read it
+	/// Unlike run(void), this run only reads the plan, so it is reentrant
+	/// and concurrent runs of the same plan are safe
+	GenericData run (ThreadPool& pool);
+
+	/// Root of the compiled graph, kept to guarantee node lifetimes
+	ade::TensptrT root_;
+
+	/// Output type of root
+	age::_GENERATED_DTYPE dtype_;
+
+	/// Instructions where every slot is written before it is read
+	std::vector<Instruction> instrs_;
+
+	/// Shape and type of every slot (data_ is unset until run)
+	std::vector<GenericData> slots_;
+
+	/// Byte offset of every slot in arena_ (root slot is not in arena)
+	std::vector<size_t> offsets_;
+
+	/// Number of bytes in arena_
+	size_t arena_size_ = 0;
+
+	/// Block of memory backing all intermediate slots
+	std::shared_ptr<char> arena_;
+
+	/// Distinct indices of instructions reading each slot
+	std::vector<std::vector<size_t>> consumers_;
+
+private:
+	/// Return slot index of tens evaluated as dtype,
+	/// compiling instructions for tens and its subgraph if necessary
+	/// If single is true, tens is a constant whose slot only holds its value
+	size_t compile (ade::iTensor* tens, age::_GENERATED_DTYPE dtype,
+		bool single = false);
+
+	/// Assign every intermediate slot to an offset in the arena, such that
+	/// slots only share bytes if one is dead before the other is written
+	void plan_memory (void);
+
+	/// Map of tensor, evaluated type and whether only a single constant
+	/// value is evaluated to slot index
+	std::map<std::tuple<ade::iTensor*,age::_GENERATED_DTYPE,bool>,
+		size_t> compiled_;
+};
+
+}
+
+#endif // LLO_PLAN_HPP
@@ -0,0 +1,134 @@
+///
+/// pool.hpp
+/// llo
+///
+/// Purpose:
+/// Define work-stealing thread pool used to evaluate independent
+/// parts of equation graphs concurrently
+///
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifndef LLO_POOL_HPP
+#define LLO_POOL_HPP
+
+namespace llo
+{
+
+/// Unit of work executed by ThreadPool
+using TaskT = std::function<void()>;
+
+/// Fixed number of worker threads each owning a deque of tasks
+/// Workers take tasks from the back of their own deque and, when it is
+/// empty, steal from the front of other workers' deques
+struct ThreadPool final
+{
+	/// Create pool of nthreads workers, use hardware concurrency if 0
+	ThreadPool (size_t nthreads = 0);
+
+	~ThreadPool (void);
+
+	ThreadPool (const ThreadPool&) = delete;
+
+	ThreadPool& operator = (const ThreadPool&) = delete;
+
+	/// Queue task for execution, tasks submitted by a worker of this pool
+	/// are pushed to that worker's deque, otherwise deques are used round robin
+	void submit (TaskT task);
+
+	/// Execute one queued task on the calling thread if any is available
+	/// Return true if a task was executed, false otherwise
+	/// Threads waiting on tasks use this to help rather than block
+	bool run_pending (void);
+
+	/// Decrement count and wake threads waiting for it in wait
+	/// Tasks completing work awaited by wait must count down through this,
+	/// and must not access count or their caller's state afterwards
+	void count_down (std::atomic<size_t>& count);
+
+	/// Execute queued tasks on the calling thread until count reaches zero,
+	/// sleeping while no task is queued instead of spinning
+	void wait (const std::atomic<size_t>& count);
+
+	/// Return the number of worker threads
+	size_t nthreads (void) const
+	{
+		return workers_.size();
+	}
+
+private:
+	struct Worker
+	{
+		std::deque<TaskT> tasks_;
+
+		std::mutex mutex_;
+	};
+
+	/// Pop a task from the back of deque at index own if own is valid,
+	/// otherwise steal a task from the front of any deque
+	bool take (size_t own, TaskT& out);
+
+	/// Worker thread loop
+	void work (size_t index);
+
+	/// Per-worker task deques
+	std::vector<std::unique_ptr<Worker>> workers_;
+
+	/// Worker threads, parallel to workers_
+	std::vector<std::thread> threads_;
+
+	/// Number of queued tasks not yet taken
+	std::atomic<size_t> npending_;
+
+	/// Round robin index for tasks submitted from outside the pool
+	std::atomic<size_t> next_;
+
+	/// Mutex and condition notifying idle workers and threads in wait
+	/// of new tasks, and threads in wait of counts reaching zero
+	std::mutex idle_mutex_;
+
+	std::condition_variable idle_cond_;
+
+	/// True when pool is shutting down
+	bool stop_;
+};
+
+/// Return pool shared by llo operations, created on first use
+/// with as many workers as hardware concurrency allows
+ThreadPool& get_pool (void);
+
+/// Tuning of parallel_for
+struct ParallelConfig final
+{
+	/// Ranges smaller than this many elements run serially on the caller
+	size_t threshold_ = 1 << 15;
+
+	/// Minimum number of elements in every chunk
+	size_t grain_ = 1 << 12;
+};
+
+/// Return configuration used by parallel_for
+ParallelConfig& get_parallel_config (void);
+
+/// Split range [0, n) into chunks of at least the configured grain and
+/// apply f(begin, end) to every chunk on the shared pool
+/// The caller processes chunks too and returns once all chunks are done,
+/// so calling parallel_for from a pool task does not deadlock
+void parallel_for (size_t n, std::function<void(size_t,size_t)> f);
+
+/// Apply f to chunks of range [0, n) as parallel_for above, where every
+/// index costs about cost elements of work, so threshold and grain
+/// are compared against n * cost instead of n
+void parallel_for (size_t n, size_t cost,
+	std::function<void(size_t,size_t)> f);
+
+}
+
+#endif // LLO_POOL_HPP
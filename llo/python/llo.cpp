@@ -33,11 +33,33 @@ std::vector<ade::DimT> c2pshape (ade::Shape& cshape)
 	return std::vector<ade::DimT>(fwd.rbegin(), fwd.rend());
 }
 
+/// Return data of array as type T without copying it when the array is
+/// already C-contiguous data of T, the array is kept alive by the data
+/// The aliased array is made read-only, since writes through numpy would
+/// change variables without marking them assigned, so sessions would
+/// keep stale results. Views taken before aliasing keep write access
+template <typename T>
+llo::GenericData alias (py::array data)
+{
+	auto arr = py::array_t<T,py::array::c_style|py::array::forcecast>::ensure(data);
+	if (false == bool(arr))
+	{
+		logs::fatal("cannot convert array to variable data");
+	}
+	arr.attr("setflags")(py::arg("write") = false);
+	py::buffer_info info = arr.request();
+	auto keep = new py::array(arr);
+	return llo::GenericData(std::shared_ptr<char>((char*) info.ptr,
+		[keep](char*)
+		{
+			// data can be released by evaluations outside of python
+			py::gil_scoped_acquire gil;
+			delete keep;
+		}), p2cshape(info.shape), age::get_type<T>());
+}
+
 llo::VarptrT variable (py::array data, std::string label)
 {
-	py::buffer_info info = data.request();
-	ade::Shape shape = p2cshape(info.shape);
-	size_t n = shape.n_elems();
 	auto dtype = data.dtype();
 	char kind = dtype.kind();
 	py::ssize_t tbytes = dtype.itemsize();
@@ -47,17 +69,11 @@ llo::VarptrT variable (py::array data, std::string label)
 			switch (tbytes)
 			{
 				case 4: // float32
-				{
-					float* dptr = static_cast<float*>(info.ptr);
-					return llo::get_variable(std::vector<float>(dptr, dptr + n),
-						shape, label);
-				}
+					return llo::VarptrT(new llo::Variable(
+						alias<float>(data), label));
 				case 8: // float64
-				{
-					double* dptr = static_cast<double*>(info.ptr);
-					return llo::get_variable(std::vector<double>(dptr, dptr + n),
-						shape, label);
-				}
+					return llo::VarptrT(new llo::Variable(
+						alias<double>(data), label));
 				default:
 					logs::fatalf("unsupported float type with %d bytes", tbytes);
 			}
@@ -66,29 +82,17 @@ llo::VarptrT variable (py::array data, std::string label)
 			switch (tbytes)
 			{
 				case 1: // int8
-				{
-					int8_t* dptr = static_cast<int8_t*>(info.ptr);
-					return llo::get_variable(std::vector<int8_t>(dptr, dptr + n),
-						shape, label);
-				}
+					return llo::VarptrT(new llo::Variable(
+						alias<int8_t>(data), label));
 				case 2: // int16
-				{
-					int16_t* dptr = static_cast<int16_t*>(info.ptr);
-					return llo::get_variable(std::vector<int16_t>(dptr, dptr + n),
-						shape, label);
-				}
+					return llo::VarptrT(new llo::Variable(
+						alias<int16_t>(data), label));
 				case 4: // int32
-				{
-					int32_t* dptr = static_cast<int32_t*>(info.ptr);
-					return llo::get_variable(std::vector<int32_t>(dptr, dptr + n),
-						shape, label);
-				}
+					return llo::VarptrT(new llo::Variable(
+						alias<int32_t>(data), label));
 				case 8: // int64
-				{
-					int64_t* dptr = static_cast<int64_t*>(info.ptr);
-					return llo::get_variable(std::vector<int64_t>(dptr, dptr + n),
-						shape, label);
-				}
+					return llo::VarptrT(new llo::Variable(
+						alias<int64_t>(data), label));
 				default:
 					logs::fatalf("unsupported integer type with %d bytes", tbytes);
 			}
@@ -100,26 +104,29 @@ llo::VarptrT variable (py::array data, std::string label)
 
 void assign (llo::Variable* target, py::array data)
 {
-	py::buffer_info info = data.request();
-	ade::Shape shape = p2cshape(info.shape);
-	size_t n = shape.n_elems();
-	char kind = data.dtype().kind();
-	switch (kind)
+	switch (target->type_code())
 	{
-		case 'f':
-		{
-			double* dptr = static_cast<double*>(info.ptr);
-			*target = std::vector<double>(dptr, dptr + n);
-		}
+		case age::DOUBLE:
+			target->adopt(alias<double>(data));
 			break;
-		case 'i':
-		{
-			int64_t* dptr = static_cast<int64_t*>(info.ptr);
-			*target = std::vector<int64_t>(dptr, dptr + n);
-		}
+		case age::FLOAT:
+			target->adopt(alias<float>(data));
+			break;
+		case age::INT8:
+			target->adopt(alias<int8_t>(data));
+			break;
+		case age::INT16:
+			target->adopt(alias<int16_t>(data));
+			break;
+		case age::INT32:
+			target->adopt(alias<int32_t>(data));
+			break;
+		case age::INT64:
+			target->adopt(alias<int64_t>(data));
 			break;
 		default:
-			logs::fatalf("unknown dtype %c", kind);
+			logs::fatalf("cannot assign to variable of type %s",
+				age::name_type((age::_GENERATED_DTYPE) target->type_code()).c_str());
 	}
 }
 
@@ -190,20 +197,38 @@ PYBIND11_MODULE(llo, m)
 	py::implicitly_convertible<ade::iTensor,llo::Variable>();
 
 	// variable
-	m.def("variable", &pyllo::variable, "create tensor variable");
+	m.def("variable", &pyllo::variable, "create tensor variable sharing "
+		"data of the array when possible, making the array read-only");
 	variable
 		.def("assign", [](py::object self, py::array data)
 		{
 			pyllo::assign(self.cast<llo::Variable*>(), data);
-		}, "assign to variable");
+		}, "assign to variable sharing data of the array when possible, "
+		"making the array read-only");
 
 
 	// inline
 	m.def("evaluate", &pyllo::evaluate, "evaluate tensor",
 		py::arg("tens"), py::arg("dtype") = py::dtype::of<double>(),
 		"evaluate data of tens according to dtype");
-	m.def("derive", llo::derive,
+	m.def("derive", (ade::TensptrT(*)(ade::TensptrT,ade::iTensor*)) llo::derive,
 		"derive tensor with respect to some derive");
+	m.def("derive_all", [](ade::TensptrT root, ade::TensT targets)
+		{
+			std::vector<ade::iTensor*> tptrs;
+			for (ade::TensptrT& target : targets)
+			{
+				tptrs.push_back(target.get());
+			}
+			llo::GradsT grads = llo::derive(root, tptrs);
+			ade::TensT out;
+			for (ade::iTensor* target : tptrs)
+			{
+				out.push_back(grads[target]);
+			}
+			return out;
+		}, "derive tensor with respect to every target in one pass, "
+		"return derivatives in the same order as targets");
 	m.def("seed", &pyllo::seed_engine, "seed internal rng");
 	m.def("print_graph", [](ade::TensptrT root, bool showshape)
 		{
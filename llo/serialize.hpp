@@ -6,6 +6,10 @@
 /// Define functions for marshal and unmarshal data sources
 ///
 
+#include <functional>
+
+#include "pbm/data.hpp"
+
 #include "llo/data.hpp"
 
 #ifndef LLO_SERIALIZE_HPP
@@ -14,12 +18,102 @@
 namespace llo
 {
 
+/// Return true if the host stores values most significant byte first,
+/// where marshalled data is stored least significant byte first
+bool is_big_endian (void);
+
 /// Marshal data to cortenn::Source
 std::string serialize (const char* in, size_t nelems, size_t typecode);
 
-/// Unmarshal cortenn::Source as Variable containing context of source
+/// Return properties of leaf recognized by llo's optimizations,
+/// for pbm::GraphSaver to save alongside its data
+/// Constants save only their single value instead of every element
+pbm::LeafInfo leaf_info (ade::iLeaf* leaf);
+
+/// Unmarshal cortenn::Source as Variable containing context of source,
+/// marked constant if info says the source's data never changes,
+/// or as Constant if info holds a single value, in which case pb is
+/// that value, so it can be used directly as pbm::InfoLoaderT
 ade::TensptrT deserialize (const char* pb, ade::Shape shape,
-	size_t typecode, std::string label);
+	size_t typecode, std::string label, pbm::LeafInfo info = pbm::LeafInfo());
+
+/// Functor returning marshalled data of a source when called
+using FetchT = std::function<std::string(void)>;
+
+/// Leaf standing in for a source whose marshalled data is only fetched
+/// and unmarshalled the first time its data is read
+struct LazyVariable final : public ade::iLeaf
+{
+	LazyVariable (FetchT fetch, ade::Shape shape,
+		size_t typecode, std::string label, bool constant = false) :
+		label_(label), constant_(constant), fetch_(fetch),
+		shape_(shape), typecode_(typecode) {}
+
+	/// Implementation of iTensor
+	const ade::Shape& shape (void) const override
+	{
+		return shape_;
+	}
+
+	/// Implementation of iTensor
+	std::string to_string (void) const override
+	{
+		return label_ + "(" + shape_.to_string() + ")";
+	}
+
+	/// Implementation of iLeaf
+	void* data (void) override
+	{
+		return get_var()->data();
+	}
+
+	/// Implementation of iLeaf
+	const void* data (void) const override
+	{
+		return get_var()->data();
+	}
+
+	/// Implementation of iLeaf
+	size_t type_code (void) const override
+	{
+		return typecode_;
+	}
+
+	/// Return true if data is already fetched
+	bool is_loaded (void) const
+	{
+		return nullptr != var_;
+	}
+
+	/// Return variable of fetched data, fetching it on the first call
+	Variable* get_var (void) const;
+
+	/// Label for distinguishing variable nodes
+	std::string label_;
+
+	/// True if the source's data never changes, known without fetching it
+	/// The fetched variable is marked constant accordingly
+	bool constant_;
+
+private:
+	/// Source of marshalled data, released once fetched
+	mutable FetchT fetch_;
+
+	ade::Shape shape_;
+
+	size_t typecode_;
+
+	/// Unmarshalled data
+	mutable ade::TensptrT var_;
+
+	mutable std::once_flag fetched_;
+};
+
+/// Return leaf of data unmarshalled from the result of fetch on first read,
+/// marked constant according to info, or Constant of info's value if set,
+/// so it can be used directly as pbm::LazyLoaderT
+ade::TensptrT lazy_deserialize (FetchT fetch, ade::Shape shape,
+	size_t typecode, std::string label, pbm::LeafInfo info);
 
 }
 
@@ -0,0 +1,62 @@
+///
+/// session.hpp
+/// llo
+///
+/// Purpose:
+/// Define evaluation session reusing results of unchanged subgraphs
+/// between evaluations
+///
+
+#include "llo/eval.hpp"
+
+#ifndef LLO_SESSION_HPP
+#define LLO_SESSION_HPP
+
+namespace llo
+{
+
+/// Repeated evaluation of root tensor according to dtype
+/// Results of every node are kept between runs, and each run only
+/// recomputes nodes downstream of Variables assigned since the previous
+/// run or of random operators, which are recomputed every run
+/// LazyVariables are tracked through their Variable once fetched
+struct Session final
+{
+	Session (ade::TensptrT root, age::_GENERATED_DTYPE dtype);
+
+	/// Return data of root evaluated as dtype
+	/// Returned data may be shared with the session's cached results,
+	/// so it must not be modified
+	GenericData run (void);
+
+	/// Return data of tens cached by the previous run,
+	/// or data without a buffer if tens has no cached result
+	/// Data is shared with the session, so it must not be modified
+	GenericData get_result (ade::iTensor* tens) const;
+
+	/// Root of the evaluated graph, kept to guarantee node lifetimes
+	ade::TensptrT root_;
+
+private:
+	/// Append tens and its subgraph to order_ in post order
+	void sort (ade::iTensor* tens);
+
+	/// Evaluator holding results of the previous run
+	Evaluator evaler_;
+
+	/// Nodes of the graph where children precede their parents
+	std::vector<ade::iTensor*> order_;
+
+	/// Index of every node in order_
+	std::unordered_map<ade::iTensor*,size_t> indices_;
+
+	/// Indices in order_ of every node's children
+	std::vector<std::vector<size_t>> children_;
+
+	/// Version of every Variable in order_ at the previous run
+	std::vector<size_t> versions_;
+};
+
+}
+
+#endif // LLO_SESSION_HPP
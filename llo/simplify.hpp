@@ -0,0 +1,30 @@
+///
+/// simplify.hpp
+/// llo
+///
+/// Purpose:
+/// Define llo algebraic simplification
+///
+
+#include "opt/rewrite.hpp"
+
+#include "llo/data.hpp"
+
+#ifndef LLO_SIMPLIFY_HPP
+#define LLO_SIMPLIFY_HPP
+
+namespace llo
+{
+
+/// Return algebraic identity rules of llo opcodes
+/// Rules only apply to identity-mapped arguments, so replacements
+/// never change the shape or element order of their parents' inputs
+opt::RulesT simplify_rules (void);
+
+/// Return graph of root with algebraic identities such as
+/// mul(x, 1) -> x, neg(neg(x)) -> x and sub(x, x) -> 0 removed
+ade::TensptrT simplify (ade::TensptrT root);
+
+}
+
+#endif // LLO_SIMPLIFY_HPP
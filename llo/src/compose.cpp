@@ -0,0 +1,46 @@
+#include "llo/generated/codes.hpp"
+
+#include "llo/compose.hpp"
+#include "llo/fused.hpp"
+
+#ifdef LLO_COMPOSE_HPP
+
+namespace llo
+{
+
+ade::TensptrT compose_maps (ade::TensptrT root)
+{
+	opt::MapComposer composer(
+		[](ade::iFunctor* func)
+		{
+			switch (func->get_opcode().code_)
+			{
+				case age::SUM:
+				case age::PROD:
+				case age::MIN:
+				case age::MAX:
+					return true;
+				default:
+					return false;
+			}
+		},
+		[](ade::iFunctor* func)
+		{
+			switch (func->get_opcode().code_)
+			{
+				case age::BAD_OP:
+				case age::MATMUL:
+				case age::CONV2D:
+				case age::CONV2D_IMGGRAD:
+				case age::CONV2D_KERNGRAD:
+					return false;
+				default:
+					return true;
+			}
+		}, rebuild);
+	return composer.compose(root);
+}
+
+}
+
+#endif
@@ -0,0 +1,96 @@
+#include "llo/contiguous.hpp"
+
+#ifdef LLO_CONTIGUOUS_HPP
+
+// clone loops for wider vector units, picking the best clone
+// supported by the running cpu when the library is loaded
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define _MULTIVERSION __attribute__((target_clones("avx512f","avx2","default")))
+#else
+#define _MULTIVERSION
+#endif
+
+// glibc's vector math library (libmvec) has simd variants of sin, cos,
+// exp, log and pow, but math.h only declares them under -ffast-math
+// Declaring them here lets loops under omp simd (built with
+// -fopenmp-simd) call the variant of each clone's vector width,
+// which agree with libm within 4 ulp
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) &&\
+	defined(__GLIBC__)
+extern "C"
+{
+#pragma omp declare simd notinbranch
+double sin (double) throw();
+#pragma omp declare simd notinbranch
+float sinf (float) throw();
+#pragma omp declare simd notinbranch
+double cos (double) throw();
+#pragma omp declare simd notinbranch
+float cosf (float) throw();
+#pragma omp declare simd notinbranch
+double exp (double) throw();
+#pragma omp declare simd notinbranch
+float expf (float) throw();
+#pragma omp declare simd notinbranch
+double log (double) throw();
+#pragma omp declare simd notinbranch
+float logf (float) throw();
+#pragma omp declare simd notinbranch
+double pow (double, double) throw();
+#pragma omp declare simd notinbranch
+float powf (float, float) throw();
+}
+#define _SIMD _Pragma("omp simd")
+#else
+#define _SIMD
+#endif
+
+namespace llo
+{
+
+#define _CONTIG_UNARY(OP, TYPE)\
+_MULTIVERSION void contiguous_unary (\
+	TYPE* out, const TYPE* in, size_t n, OP f)\
+{ _SIMD for (size_t i = 0; i < n; ++i) { out[i] = f(in[i]); } }
+
+#define _CONTIG_BINARY(OP, TYPE)\
+_MULTIVERSION void contiguous_binary (\
+	TYPE* out, const TYPE* a, const TYPE* b, size_t n, OP f)\
+{ _SIMD for (size_t i = 0; i < n; ++i) { out[i] = f(a[i], b[i]); } }
+
+#define _CONTIG_ACC(OP, TYPE)\
+_MULTIVERSION void contiguous_acc (\
+	TYPE* out, const TYPE* in, size_t n, OP acc)\
+{ _SIMD for (size_t i = 0; i < n; ++i) { acc(out[i], in[i]); } }
+
+#define _CONTIG_REAL(TYPE)\
+_CONTIG_UNARY(SinOp, TYPE)\
+_CONTIG_UNARY(CosOp, TYPE)\
+_CONTIG_UNARY(ExpOp, TYPE)\
+_CONTIG_UNARY(LogOp, TYPE)\
+_CONTIG_UNARY(SqrtOp, TYPE)\
+_CONTIG_BINARY(PowOp, TYPE)\
+_CONTIG_BINARY(DivOp, TYPE)
+
+#define _CONTIG_COMMON(TYPE)\
+_CONTIG_UNARY(AbsOp, TYPE)\
+_CONTIG_UNARY(NegOp, TYPE)\
+_CONTIG_BINARY(SubOp, TYPE)\
+_CONTIG_BINARY(EqOp, TYPE)\
+_CONTIG_BINARY(NeqOp, TYPE)\
+_CONTIG_BINARY(LtOp, TYPE)\
+_CONTIG_BINARY(GtOp, TYPE)\
+_CONTIG_ACC(AddAcc, TYPE)\
+_CONTIG_ACC(MulAcc, TYPE)\
+_CONTIG_ACC(MinAcc, TYPE)\
+_CONTIG_ACC(MaxAcc, TYPE)
+
+_CONTIG_REAL(double)
+_CONTIG_REAL(float)
+_CONTIG_COMMON(double)
+_CONTIG_COMMON(float)
+_CONTIG_COMMON(int32_t)
+
+}
+
+#endif
@@ -0,0 +1,77 @@
+#include <cstring>
+
+#include "llo/cse.hpp"
+#include "llo/fold.hpp"
+#include "llo/fused.hpp"
+
+#ifdef LLO_CSE_HPP
+
+namespace llo
+{
+
+/// Return 64 bit FNV-1a hash of n bytes of data
+static uint64_t hash_bytes (const char* data, size_t n)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < n; ++i)
+	{
+		hash = (hash ^ (unsigned char) data[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+std::string constant_key (ade::iLeaf* leaf)
+{
+	if (auto cst = dynamic_cast<Constant*>(leaf))
+	{
+		size_t dtype = cst->type_code();
+		const ade::Shape& shape = cst->shape();
+		std::string key((const char*) &dtype, sizeof(dtype));
+		key.append(shape.begin(), shape.end());
+		key.append(cst->value(), type_size((age::_GENERATED_DTYPE) dtype));
+		return "scalar:" + key;
+	}
+	Variable* var = constant_variable(leaf);
+	if (nullptr == var)
+	{
+		return "";
+	}
+	size_t dtype = var->type_code();
+	const ade::Shape& shape = var->shape();
+	uint64_t hash = hash_bytes((const char*) var->data(), var->nbytes());
+	std::string key((const char*) &dtype, sizeof(dtype));
+	key.append(shape.begin(), shape.end());
+	key.append((const char*) &hash, sizeof(hash));
+	return key;
+}
+
+bool equal_constants (ade::iLeaf* a, ade::iLeaf* b)
+{
+	// keys of Constants hold their entire value
+	if (nullptr != dynamic_cast<Constant*>(a))
+	{
+		return true;
+	}
+	Variable* avar = constant_variable(a);
+	Variable* bvar = constant_variable(b);
+	return nullptr != avar && nullptr != bvar &&
+		avar->nbytes() == bvar->nbytes() &&
+		0 == std::memcmp(avar->data(), bvar->data(), avar->nbytes());
+}
+
+bool is_mergeable (ade::iFunctor* func)
+{
+	// fused functors share an opcode regardless of their steps
+	return false == is_random(func) &&
+		nullptr == dynamic_cast<FusedFunctor*>(func);
+}
+
+ade::TensptrT merge_common (ade::TensptrT root)
+{
+	opt::CSE cse(constant_key, is_mergeable, rebuild, equal_constants);
+	return cse.merge(root);
+}
+
+}
+
+#endif
@@ -1,3 +1,5 @@
+#include "opt/compose.hpp"
+
 #include "llo/data.hpp"
 
 #ifdef LLO_DATA_HPP
@@ -17,13 +19,13 @@ GenericData::GenericData (ade::Shape shape, age::_GENERATED_DTYPE dtype) :
 	data_((char*) malloc(shape.n_elems() * type_size(dtype)),
 		CDeleter()), shape_(shape), dtype_(dtype) {}
 
-#define COPYOVER(TYPE) { std::vector<TYPE> temp(indata, indata + n);\
-	std::memcpy(out, &temp[0], nbytes); } break;
+// convert straight into out, loops of static casts are vectorized by
+// the compiler
+#define COPYOVER(TYPE) std::copy(indata, indata + n, (TYPE*) out); break;
 
 template <typename T>
 void convert (char* out, age::_GENERATED_DTYPE outtype, const T* indata, size_t n)
 {
-	size_t nbytes = type_size(outtype) * n;
 	switch (outtype)
 	{
 		case age::DOUBLE: COPYOVER(double)
@@ -52,6 +54,7 @@ void GenericData::copyover (const char* indata, age::_GENERATED_DTYPE intype)
 	if (dtype_ == intype)
 	{
 		std::memcpy(data_.get(), indata, type_size(dtype_) * n);
+		return;
 	}
 	switch (intype)
 	{
@@ -72,6 +75,64 @@ void GenericData::copyover (const char* indata, age::_GENERATED_DTYPE intype)
 
 #undef CONVERT
 
+void Constant::fill (GenericData& out) const
+{
+	GenericData value(ade::Shape(), out.dtype_);
+	value.copyover(value_.data_.get(), value_.dtype_);
+	size_t tsize = type_size(out.dtype_);
+	char* dest = out.data_.get();
+	for (size_t i = 0, n = out.shape_.n_elems(); i < n; ++i)
+	{
+		std::memcpy(dest + i * tsize, value.data_.get(), tsize);
+	}
+}
+
+ade::CoordptrT broadcast = std::make_shared<ade::CoordMap>(
+	[](ade::MatrixT fwd)
+	{
+		fwd[ade::rank_cap][ade::rank_cap] = 1;
+	});
+
+bool is_random (ade::iFunctor* func)
+{
+	switch (func->get_opcode().code_)
+	{
+		case age::RAND_BINO:
+		case age::RAND_UNIF:
+		case age::RAND_NORM:
+			return true;
+		default:
+			return false;
+	}
+}
+
+bool can_broadcast (age::_GENERATED_OPCODE consumer,
+	const ade::MappedTensor& arg)
+{
+	switch (consumer)
+	{
+		// unary kernels take their output shape from their argument
+		case age::ABS:
+		case age::NEG:
+		case age::SIN:
+		case age::COS:
+		case age::TAN:
+		case age::EXP:
+		case age::LOG:
+		case age::SQRT:
+		case age::ROUND:
+		case age::BAD_OP:
+		case age::MATMUL:
+		case age::CONV2D:
+		case age::CONV2D_IMGGRAD:
+		case age::CONV2D_KERNGRAD:
+			return false;
+		default:
+			break;
+	}
+	return false == arg.map_io() || opt::is_bijective(*arg.get_coorder());
+}
+
 }
 
 #endif
@@ -9,6 +9,20 @@ GenericData eval (ade::TensptrT tens, age::_GENERATED_DTYPE dtype)
 {
 	Evaluator eval(dtype);
 	tens->accept(eval);
+	if (auto cst = dynamic_cast<Constant*>(tens.get()))
+	{
+		GenericData full(cst->shape(), dtype);
+		cst->fill(full);
+		return full;
+	}
+	auto var = dynamic_cast<Variable*>(tens.get());
+	if (nullptr != var && var->type_code() == dtype)
+	{
+		// evaluated data borrows variable data, so copy it for the caller
+		GenericData out(var->shape(), dtype);
+		out.copyover((const char*) var->data(), dtype);
+		return out;
+	}
 	return eval.out_;
 }
 
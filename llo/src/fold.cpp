@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <unordered_map>
+
+#include "opt/compose.hpp"
+
+#include "llo/eval.hpp"
+#include "llo/fold.hpp"
+#include "llo/fused.hpp"
+#include "llo/serialize.hpp"
+
+#ifdef LLO_FOLD_HPP
+
+namespace llo
+{
+
+Variable* constant_variable (ade::iTensor* tens)
+{
+	if (auto lazy = dynamic_cast<LazyVariable*>(tens))
+	{
+		// data is never fetched only to optimize
+		return lazy->constant_ && lazy->is_loaded() ?
+			lazy->get_var() : nullptr;
+	}
+	auto var = dynamic_cast<Variable*>(tens);
+	if (nullptr == var || false == var->constant_)
+	{
+		return nullptr;
+	}
+	return var;
+}
+
+bool is_constant (ade::iLeaf* leaf)
+{
+	if (nullptr != dynamic_cast<Constant*>(leaf))
+	{
+		return true;
+	}
+	if (auto lazy = dynamic_cast<LazyVariable*>(leaf))
+	{
+		return lazy->constant_;
+	}
+	auto var = dynamic_cast<Variable*>(leaf);
+	return nullptr != var && var->constant_;
+}
+
+/// Return true if every one of n elements of data equals value,
+/// stopping at the first element that differs
+template <typename T>
+static bool all_equal (const T* data, size_t n, double value)
+{
+	return std::all_of(data, data + n,
+		[value](T d) { return value == (double) d; });
+}
+
+#define ALL_EQUAL(TYPE) return all_equal((const TYPE*) data, n, value);
+
+/// Return true if every one of n elements of data of dtype equals value
+/// when converted to double, comparing elements in their own type
+static bool all_equal (const void* data, age::_GENERATED_DTYPE dtype,
+	size_t n, double value)
+{
+	switch (dtype)
+	{
+		case age::DOUBLE: ALL_EQUAL(double)
+		case age::FLOAT: ALL_EQUAL(float)
+		case age::INT8: ALL_EQUAL(int8_t)
+		case age::INT16: ALL_EQUAL(int16_t)
+		case age::INT32: ALL_EQUAL(int32_t)
+		case age::INT64: ALL_EQUAL(int64_t)
+		case age::UINT8: ALL_EQUAL(uint8_t)
+		case age::UINT16: ALL_EQUAL(uint16_t)
+		case age::UINT32: ALL_EQUAL(uint32_t)
+		case age::UINT64: ALL_EQUAL(uint64_t)
+		default: logs::fatalf("invalid input type %s",
+			age::name_type(dtype).c_str());
+	}
+	return false;
+}
+
+#undef ALL_EQUAL
+
+bool is_constant_value (ade::iTensor* tens, double value)
+{
+	if (auto cst = dynamic_cast<Constant*>(tens))
+	{
+		return all_equal(cst->value(),
+			(age::_GENERATED_DTYPE) cst->type_code(), 1, value);
+	}
+	Variable* var = constant_variable(tens);
+	if (nullptr == var)
+	{
+		return false;
+	}
+	return all_equal(var->data(), (age::_GENERATED_DTYPE) var->type_code(),
+		var->shape().n_elems(), value);
+}
+
+/// Return true if tens has the same value at every element, which holds
+/// when it applies only elementwise operations to Constants through
+/// mappings reading a single element of each argument per output
+static bool is_uniform (ade::iTensor* tens,
+	std::unordered_map<ade::iTensor*,bool>& uniforms)
+{
+	auto it = uniforms.find(tens);
+	if (uniforms.end() != it)
+	{
+		return it->second;
+	}
+	bool out = nullptr != dynamic_cast<Constant*>(tens);
+	if (auto func = dynamic_cast<ade::iFunctor*>(tens))
+	{
+		out = is_fusable((age::_GENERATED_OPCODE) func->get_opcode().code_);
+		for (const ade::MappedTensor& child : func->get_children())
+		{
+			out = out && is_uniform(child.get_tensor().get(), uniforms) &&
+				(false == child.map_io() ||
+				opt::is_bijective(*child.get_coorder()));
+		}
+	}
+	uniforms.emplace(tens, out);
+	return out;
+}
+
+/// Return the single value of uniform tens evaluated as dtype
+static GenericData eval_uniform (ade::iTensor* tens,
+	age::_GENERATED_DTYPE dtype)
+{
+	GenericData out(ade::Shape(), dtype);
+	if (auto cst = dynamic_cast<Constant*>(tens))
+	{
+		out.copyover(cst->value(), (age::_GENERATED_DTYPE) cst->type_code());
+		return out;
+	}
+	auto func = static_cast<ade::iFunctor*>(tens);
+	DataArgsT args;
+	for (const ade::MappedTensor& child : func->get_children())
+	{
+		args.push_back(DataArg{
+			eval_uniform(child.get_tensor().get(), dtype).data_,
+			ade::Shape(), ade::identity, false});
+	}
+	op_exec((age::_GENERATED_OPCODE) func->get_opcode().code_,
+		dtype, out.data_.get(), out.shape_, args);
+	return out;
+}
+
+ade::TensptrT const_fold (ade::TensptrT root, age::_GENERATED_DTYPE dtype)
+{
+	// evaluators are shared between folds, since constant
+	// subgraphs folded separately can still share nodes
+	Evaluator evaler(dtype);
+	std::unordered_map<ade::iTensor*,bool> uniforms;
+	opt::ConstFolder folder(is_constant,
+		[](ade::iFunctor* func)
+		{
+			return false == is_random(func);
+		},
+		[&](ade::iFunctor* func)
+		{
+			// uniform subgraphs fold to a single value instead of
+			// materializing every element of their shape
+			if (is_uniform(func, uniforms))
+			{
+				GenericData value = eval_uniform(func, dtype);
+				return ade::TensptrT(new Constant(value.data_.get(),
+					dtype, func->shape(), func->to_string()));
+			}
+			func->accept(evaler);
+			GenericData& data = evaler.out_;
+			VarptrT out(new Variable(data.data_.get(), data.dtype_,
+				data.shape_, func->to_string()));
+			out->constant_ = true;
+			return ade::TensptrT(out);
+		}, rebuild);
+	return folder.fold(root);
+}
+
+}
+
+#endif
@@ -0,0 +1,175 @@
+#include "llo/generated/opmap.hpp"
+
+#include "llo/fused.hpp"
+#include "llo/pool.hpp"
+#include "llo/stride.hpp"
+
+#ifdef LLO_FUSED_HPP
+
+namespace llo
+{
+
+void FusedFunctor::eval (char* out, age::_GENERATED_DTYPE dtype,
+	const DataArgsT& inputs) const
+{
+	size_t ninputs = args_.size();
+	if (inputs.size() != ninputs)
+	{
+		logs::fatalf("cannot evaluate fused functor of %d inputs "
+			"with %d arguments", ninputs, inputs.size());
+	}
+	size_t nsteps = steps_.size();
+	size_t tsize = age::type_size(dtype);
+	parallel_for(shape_.n_elems(),
+		[&](size_t begin, size_t end)
+		{
+			// scratch of every step except the last,
+			// which writes directly to out
+			std::vector<std::shared_ptr<char>> scratch(nsteps - 1);
+			for (std::shared_ptr<char>& buf : scratch)
+			{
+				buf = std::shared_ptr<char>(
+					(char*) malloc(fused_block * tsize),
+					[](char* p) { free(p); });
+			}
+			std::vector<std::shared_ptr<char>> values(ninputs + nsteps);
+			for (size_t offset = begin; offset < end; offset += fused_block)
+			{
+				size_t n = std::min(fused_block, end - offset);
+				ade::Shape shape({(ade::DimT) n});
+				for (size_t i = 0; i < ninputs; ++i)
+				{
+					// alias input data without taking ownership of it
+					values[i] = std::shared_ptr<char>(inputs[i].data_,
+						inputs[i].data_.get() + offset * tsize);
+				}
+				for (size_t i = 0; i < nsteps; ++i)
+				{
+					const FusedStep& step = steps_[i];
+					DataArgsT args;
+					for (size_t arg : step.args_)
+					{
+						args.push_back(DataArg{
+							values[arg], shape, ade::identity, true});
+					}
+					char* dest = i + 1 < nsteps ?
+						scratch[i].get() : out + offset * tsize;
+					op_exec(step.opcode_, dtype, dest, shape, args);
+					if (i + 1 < nsteps)
+					{
+						values[ninputs + i] = scratch[i];
+					}
+				}
+			}
+		});
+}
+
+bool is_fusable (age::_GENERATED_OPCODE opcode)
+{
+	switch (opcode)
+	{
+		case age::ABS:
+		case age::NEG:
+		case age::SIN:
+		case age::COS:
+		case age::TAN:
+		case age::EXP:
+		case age::LOG:
+		case age::SQRT:
+		case age::ROUND:
+		case age::POW:
+		case age::SUM:
+		case age::SUB:
+		case age::PROD:
+		case age::DIV:
+		case age::MIN:
+		case age::MAX:
+		case age::EQ:
+		case age::NEQ:
+		case age::LT:
+		case age::GT:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/// Append steps evaluating func to steps and return index of its value
+static size_t add_steps (std::vector<FusedStep>& steps, ade::iFunctor* func,
+	const std::vector<ade::iTensor*>& boundary)
+{
+	FusedStep step{(age::_GENERATED_OPCODE) func->get_opcode().code_, {}};
+	for (const ade::MappedTensor& child : func->get_children())
+	{
+		ade::iTensor* tens = child.get_tensor().get();
+		auto it = std::find(boundary.begin(), boundary.end(), tens);
+		if (boundary.end() != it)
+		{
+			step.args_.push_back(it - boundary.begin());
+		}
+		else
+		{
+			// children outside the boundary belong to the fused region
+			step.args_.push_back(add_steps(steps,
+				static_cast<ade::iFunctor*>(tens), boundary));
+		}
+	}
+	steps.push_back(step);
+	return boundary.size() + steps.size() - 1;
+}
+
+ade::TensptrT rebuild (ade::iFunctor* func, ade::ArgsT args)
+{
+	auto fused = dynamic_cast<FusedFunctor*>(func);
+	if (nullptr == fused)
+	{
+		return opt::rebuild_functor(func, args);
+	}
+	ade::TensT inputs;
+	for (const ade::MappedTensor& arg : args)
+	{
+		if (false == is_identity(*arg.get_shaper()) ||
+			false == is_identity(*arg.get_coorder()))
+		{
+			logs::fatal("cannot rebuild fused functor over mapped inputs");
+		}
+		inputs.push_back(arg.get_tensor());
+	}
+	return ade::TensptrT(new FusedFunctor(
+		fused->shape(), inputs, fused->get_steps()));
+}
+
+ade::TensptrT fuse (ade::TensptrT root)
+{
+	opt::Fuser fuser(
+		[](ade::iFunctor* func)
+		{
+			if (false == is_fusable(
+				(age::_GENERATED_OPCODE) func->get_opcode().code_))
+			{
+				return false;
+			}
+			for (const ade::MappedTensor& child : func->get_children())
+			{
+				if (false == is_identity(*child.get_shaper()) ||
+					false == is_identity(*child.get_coorder()))
+				{
+					return false;
+				}
+			}
+			return true;
+		},
+		[](ade::iFunctor* subroot, std::vector<ade::iTensor*> boundary,
+			ade::TensT inputs)
+		{
+			std::vector<FusedStep> steps;
+			add_steps(steps, subroot, boundary);
+			return ade::TensptrT(new FusedFunctor(
+				subroot->shape(), inputs, steps));
+		}, rebuild);
+	return fuser.fuse(root);
+}
+
+}
+
+#endif
@@ -1,3 +1,6 @@
+#include <array>
+#include <cmath>
+
 #include "llo/generated/api.hpp"
 #include "llo/generated/codes.hpp"
 #include "llo/data.hpp"
@@ -89,11 +92,62 @@ ade::TensptrT matmul (ade::TensptrT a, ade::TensptrT b)
 			"higher than 2-D", bshape.to_string().c_str());
 	}
 
-	return age::reduce_sum(
-		age::mul(
-			age::permute(age::extend(a, 2, {bshape.at(0)}), {2,1,0}),
-			age::permute(age::extend(b, 2, {ashape.at(1)}), {0,2,1})
-		), 2);
+	// shapers only map argument shapes to output shape [M, N],
+	// gemm reads arguments in their original layout
+	// input: [C, N]
+	// output: [M, N]
+	ade::CoordptrT a_shaper(new ade::CoordMap(
+		[&](ade::MatrixT fwd)
+		{
+			fwd[2][0] = M;
+			fwd[1][1] = 1;
+			fwd[0][2] = 1;
+			fwd[ade::mat_dim - 1][2] = 1.0 - C;
+			for (uint8_t i = 3; i < ade::mat_dim; ++i)
+			{
+				fwd[i][i] = 1;
+			}
+		}));
+
+	// input: [M, C]
+	// output: [M, N]
+	ade::CoordptrT b_shaper(new ade::CoordMap(
+		[&](ade::MatrixT fwd)
+		{
+			fwd[0][0] = 1;
+			fwd[2][1] = N;
+			fwd[1][2] = 1;
+			fwd[ade::mat_dim - 1][2] = 1.0 - C;
+			for (uint8_t i = 3; i < ade::mat_dim; ++i)
+			{
+				fwd[i][i] = 1;
+			}
+		}));
+
+	return ade::TensptrT(ade::Functor::get(ade::Opcode{"MATMUL", age::MATMUL}, {
+		ade::MappedTensor(a, a_shaper),
+		ade::MappedTensor(b, b_shaper),
+	}));
+}
+
+/// Return shaper mapping dimension order[i] of 4-D input to dimension i
+/// of output, then adding trans[i] to output dimension i
+static ade::CoordptrT order_shaper (std::array<uint8_t,4> order,
+	std::array<double,4> trans)
+{
+	return ade::CoordptrT(new ade::CoordMap(
+		[&](ade::MatrixT fwd)
+		{
+			for (uint8_t i = 0; i < 4; ++i)
+			{
+				fwd[order[i]][i] = 1;
+				fwd[ade::mat_dim - 1][i] = trans[i];
+			}
+			for (uint8_t i = 4; i < ade::mat_dim; ++i)
+			{
+				fwd[i][i] = 1;
+			}
+		}));
 }
 
 // specifications according to https://www.tensorflow.org/api_docs/python/tf/nn/conv2d
@@ -104,14 +158,14 @@ ade::TensptrT convolution (ade::TensptrT img, ade::TensptrT kernel)
 	const ade::Shape& imgshape = img->shape();
 	const ade::Shape& kernelshape = kernel->shape();
 
-	uint8_t nbatch = imgshape.at(3);
-	uint8_t in_width = imgshape.at(2);
-	uint8_t in_height = imgshape.at(1);
-	uint8_t in_channels = imgshape.at(0);
+	double nbatch = imgshape.at(3);
+	double in_width = imgshape.at(2);
+	double in_height = imgshape.at(1);
+	double in_channels = imgshape.at(0);
 
-	uint8_t kernel_width = kernelshape.at(3);
-	uint8_t kernel_height = kernelshape.at(2);
-	uint8_t out_channels = kernelshape.at(0);
+	double kernel_width = kernelshape.at(3);
+	double kernel_height = kernelshape.at(2);
+	double out_channels = kernelshape.at(0);
 	if (in_channels != kernelshape.at(1))
 	{
 		logs::fatalf("cannot convolution with mismatch img %s and kernel %s "
@@ -125,80 +179,135 @@ ade::TensptrT convolution (ade::TensptrT img, ade::TensptrT kernel)
 			imgshape.to_string().c_str());
 	}
 
-	uint8_t invalid_height = 2 * std::floor(kernel_height / 2);
-	uint8_t invalid_width = 2 * std::floor(kernel_width / 2);
+	double out_height = in_height - 2 * std::floor(kernel_height / 2);
+	double out_width = in_width - 2 * std::floor(kernel_width / 2);
 
+	// shapers only map argument shapes to output shape,
+	// conv2d reads arguments in their original layout
 	// input: [in_channels, in_height, in_width, nbatch]
-	// output: [out_channels,
-	//			in_height-invalid_height,
-	//			in_width-invalid_height,
-	//			nbatch, in_channels, kernel_height, kernel_width]
-	ade::CoordptrT img_shaper(new ade::CoordMap(
-		[&](ade::MatrixT fwd)
-		{
-			fwd[0][4] =
-			fwd[1][1] =
-			fwd[2][2] =
-			fwd[3][3] = 1;
-			fwd[4][0] = out_channels;
-			fwd[5][5] = kernel_height;
-			fwd[6][6] = kernel_width;
-			fwd[ade::mat_dim - 1][1] = -invalid_height;
-			fwd[ade::mat_dim - 1][2] = -invalid_width;
-			for (uint8_t i = 7; i < ade::mat_dim; ++i)
-			{
-				fwd[i][i] = 1;
-			}
-		}));
+	// output: [out_channels, out_height, out_width, nbatch]
+	ade::CoordptrT img_shaper = order_shaper({0, 1, 2, 3}, {
+		out_channels - in_channels,
+		out_height - in_height,
+		out_width - in_width,
+		0,
+	});
 
-	ade::CoordptrT img_mapper(new ade::CoordMap(
-		[&](ade::MatrixT fwd)
-		{
-			fwd[1][1] =
-			fwd[2][2] =
-			fwd[3][3] =
-			fwd[4][0] =
-			fwd[5][1] =
-			fwd[6][2] = 1;
-			fwd[0][4] = 1.0 / out_channels;
-			fwd[1][5] = 1.0 / (in_height - invalid_height);
-			fwd[2][6] = 1.0 / (in_width - invalid_width);
-			for (uint8_t i = 7; i < ade::mat_dim; ++i)
-			{
-				fwd[i][i] = 1;
-			}
-		}));
+	// input: [out_channels, in_channels, kernel_height, kernel_width]
+	// output: [out_channels, out_height, out_width, nbatch]
+	ade::CoordptrT kernel_shaper = order_shaper({0, 2, 3, 1}, {
+		0,
+		out_height - kernel_height,
+		out_width - kernel_width,
+		nbatch - in_channels,
+	});
+
+	return ade::TensptrT(ade::Functor::get(ade::Opcode{"CONV2D", age::CONV2D}, {
+		ade::MappedTensor(img, img_shaper),
+		ade::MappedTensor(kernel, kernel_shaper),
+	}));
+}
+
+ade::TensptrT convolution_image_grad (ade::Shape imgshape,
+	ade::TensptrT kernel, ade::TensptrT grad)
+{
+	const ade::Shape& kernelshape = kernel->shape();
+	const ade::Shape& gradshape = grad->shape();
+
+	double in_channels = imgshape.at(0);
+	double in_height = imgshape.at(1);
+	double in_width = imgshape.at(2);
+	double nbatch = imgshape.at(3);
+
+	double out_channels = kernelshape.at(0);
+	double kernel_height = kernelshape.at(2);
+	double kernel_width = kernelshape.at(3);
+	if (in_channels != kernelshape.at(1) ||
+		out_channels != gradshape.at(0) ||
+		nbatch != gradshape.at(3))
+	{
+		logs::fatalf("cannot convolution image gradient of shape %s "
+			"with kernel %s and gradient %s", imgshape.to_string().c_str(),
+			kernelshape.to_string().c_str(), gradshape.to_string().c_str());
+	}
+
+	double out_height = gradshape.at(1);
+	double out_width = gradshape.at(2);
+
+	// input: [out_channels, out_height, out_width, nbatch]
+	// output: [in_channels, in_height, in_width, nbatch]
+	ade::CoordptrT grad_shaper = order_shaper({0, 1, 2, 3}, {
+		in_channels - out_channels,
+		in_height - out_height,
+		in_width - out_width,
+		0,
+	});
 
 	// input: [out_channels, in_channels, kernel_height, kernel_width]
-	// output: [out_channels,
-	//			in_height - invalid_height,
-	//			in_width - invalid_width,
-	//			nbatch, in_channels, kernel_height, kernel_width]
-	ade::CoordptrT kernel_mapper(new ade::CoordMap(
-		[&](ade::MatrixT fwd)
-		{
-			fwd[0][0] =
-			fwd[1][4] =
-			fwd[2][5] =
-			fwd[3][6] =
-			fwd[4][1] =
-			fwd[5][2] =
-			fwd[6][3] = 1;
-			fwd[ade::mat_dim - 1][1] = in_height - invalid_height - 1;
-			fwd[ade::mat_dim - 1][2] = in_width - invalid_width - 1;
-			fwd[ade::mat_dim - 1][3] = nbatch - 1;
-			for (uint8_t i = 7; i < ade::mat_dim; ++i)
-			{
-				fwd[i][i] = 1;
-			}
+	// output: [in_channels, in_height, in_width, nbatch]
+	ade::CoordptrT kernel_shaper = order_shaper({1, 2, 3, 0}, {
+		0,
+		in_height - kernel_height,
+		in_width - kernel_width,
+		nbatch - out_channels,
+	});
+
+	return ade::TensptrT(ade::Functor::get(
+		ade::Opcode{"CONV2D_IMGGRAD", age::CONV2D_IMGGRAD}, {
+			ade::MappedTensor(grad, grad_shaper),
+			ade::MappedTensor(kernel, kernel_shaper),
 		}));
+}
 
-	ade::TensptrT prod(ade::Functor::get(ade::Opcode{"PROD", age::PROD}, {
-		ade::MappedTensor(img, img_shaper, false, img_mapper),
-		ade::MappedTensor(kernel, kernel_mapper),
-	}));
+ade::TensptrT convolution_kernel_grad (ade::Shape kernelshape,
+	ade::TensptrT img, ade::TensptrT grad)
+{
+	const ade::Shape& imgshape = img->shape();
+	const ade::Shape& gradshape = grad->shape();
 
-	return age::reduce_sum(prod, 4);
+	double out_channels = kernelshape.at(0);
+	double in_channels = kernelshape.at(1);
+	double kernel_height = kernelshape.at(2);
+	double kernel_width = kernelshape.at(3);
+
+	double in_height = imgshape.at(1);
+	double in_width = imgshape.at(2);
+	double nbatch = imgshape.at(3);
+	if (in_channels != imgshape.at(0) ||
+		out_channels != gradshape.at(0) ||
+		nbatch != gradshape.at(3))
+	{
+		logs::fatalf("cannot convolution kernel gradient of shape %s "
+			"with image %s and gradient %s", kernelshape.to_string().c_str(),
+			imgshape.to_string().c_str(), gradshape.to_string().c_str());
+	}
+
+	double out_height = gradshape.at(1);
+	double out_width = gradshape.at(2);
+
+	// input: [in_channels, in_height, in_width, nbatch]
+	// output: [out_channels, in_channels, kernel_height, kernel_width]
+	ade::CoordptrT img_shaper = order_shaper({3, 0, 1, 2}, {
+		out_channels - nbatch,
+		0,
+		kernel_height - in_height,
+		kernel_width - in_width,
+	});
+
+	// input: [out_channels, out_height, out_width, nbatch]
+	// output: [out_channels, in_channels, kernel_height, kernel_width]
+	ade::CoordptrT grad_shaper = order_shaper({0, 3, 1, 2}, {
+		0,
+		in_channels - nbatch,
+		kernel_height - out_height,
+		kernel_width - out_width,
+	});
+
+	return ade::TensptrT(ade::Functor::get(
+		ade::Opcode{"CONV2D_KERNGRAD", age::CONV2D_KERNGRAD}, {
+			ade::MappedTensor(img, img_shaper),
+			ade::MappedTensor(grad, grad_shaper),
+		}));
 }
 
 }
@@ -0,0 +1,98 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+
+#include "llo/mmap.hpp"
+#include "llo/serialize.hpp"
+
+#ifdef LLO_MMAP_HPP
+
+namespace llo
+{
+
+GenericData map_data (std::string path, size_t offset,
+	ade::Shape shape, age::_GENERATED_DTYPE dtype, bool copy_on_write)
+{
+	size_t tsize = type_size(dtype);
+	if (0 != offset % tsize)
+	{
+		logs::fatalf("cannot map %s data at offset %d unaligned to its type",
+			age::name_type(dtype).c_str(), offset);
+	}
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		logs::fatalf("cannot open %s for mapping", path.c_str());
+	}
+	struct stat st;
+	size_t nbytes = shape.n_elems() * tsize;
+	if (fstat(fd, &st) < 0 || (size_t) st.st_size < offset + nbytes)
+	{
+		close(fd);
+		logs::fatalf("cannot map %d bytes at offset %d beyond the end of %s",
+			nbytes, offset, path.c_str());
+	}
+	// mappings start at page boundaries
+	size_t pagesize = sysconf(_SC_PAGESIZE);
+	size_t pageoffset = offset % pagesize;
+	size_t mapsize = pageoffset + nbytes;
+	void* region = mmap(nullptr, mapsize, copy_on_write ?
+		PROT_READ | PROT_WRITE : PROT_READ,
+		copy_on_write ? MAP_PRIVATE : MAP_SHARED, fd, offset - pageoffset);
+	// the mapping keeps the file referenced after closing
+	close(fd);
+	if (MAP_FAILED == region)
+	{
+		logs::fatalf("failed to map %s", path.c_str());
+	}
+	return GenericData(std::shared_ptr<char>((char*) region + pageoffset,
+		[region, mapsize](char*)
+		{
+			munmap(region, mapsize);
+		}), shape, dtype);
+}
+
+VarptrT map_variable (std::string path, size_t offset,
+	ade::Shape shape, age::_GENERATED_DTYPE dtype,
+	std::string label, bool copy_on_write)
+{
+	if (label.empty())
+	{
+		label = path;
+	}
+	return VarptrT(new Variable(
+		map_data(path, offset, shape, dtype, copy_on_write),
+		label, copy_on_write));
+}
+
+ade::TensptrT map_deserialize (std::string path, size_t offset,
+	ade::Shape shape, size_t typecode, std::string label, bool constant)
+{
+	age::_GENERATED_DTYPE dtype = (age::_GENERATED_DTYPE) typecode;
+	size_t tsize = type_size(dtype);
+	if ((is_big_endian() && tsize > 1) || 0 != offset % tsize)
+	{
+		size_t nbytes = shape.n_elems() * tsize;
+		std::ifstream in(path, std::ios::in | std::ios::binary);
+		std::string pb(nbytes, '\0');
+		if (false == bool(in.seekg(offset)) ||
+			false == bool(in.read(&pb[0], nbytes)))
+		{
+			logs::fatalf("failed to read %d bytes at offset %d of %s",
+				nbytes, offset, path.c_str());
+		}
+		pbm::LeafInfo info;
+		info.constant_ = constant;
+		return deserialize(pb.c_str(), shape, typecode, label, info);
+	}
+	VarptrT out = map_variable(path, offset, shape, dtype, label);
+	out->constant_ = constant;
+	return out;
+}
+
+}
+
+#endif
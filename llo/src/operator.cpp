@@ -68,7 +68,7 @@ void rand_binom<double> (double* out,
 	{
 		std::binomial_distribution<int64_t> dist(a, b);
 		return dist(get_engine());
-	});
+	}, false);
 }
 
 template <>
@@ -80,7 +80,7 @@ void rand_binom<float> (float* out,
 	{
 		std::binomial_distribution<int32_t> dist(a, b);
 		return dist(get_engine());
-	});
+	}, false);
 }
 
 template <>
@@ -92,7 +92,7 @@ void rand_uniform<double> (double* out,
 	{
 		std::uniform_real_distribution<double> dist(a, b);
 		return dist(get_engine());
-	});
+	}, false);
 }
 
 template <>
@@ -104,7 +104,7 @@ void rand_uniform<float> (float* out,
 	{
 		std::uniform_real_distribution<float> dist(a, b);
 		return dist(get_engine());
-	});
+	}, false);
 }
 
 template <>
@@ -116,7 +116,7 @@ void rand_normal<double> (double* out,
 	{
 		std::normal_distribution<double> dist(a, b);
 		return dist(get_engine());
-	});
+	}, false);
 }
 
 template <>
@@ -128,7 +128,7 @@ void rand_normal<float> (float* out,
 	{
 		std::normal_distribution<float> dist(a, b);
 		return dist(get_engine());
-	});
+	}, false);
 }
 
 }
@@ -0,0 +1,402 @@
+#include <algorithm>
+#include <cstdlib>
+#include <list>
+#include <mutex>
+
+#include "llo/plan.hpp"
+
+#ifdef LLO_PLAN_HPP
+
+namespace llo
+{
+
+/// Byte alignment of every slot in the arena
+static const size_t slot_align = 64;
+
+/// Contiguous block of bytes in the arena
+struct Block
+{
+	size_t offset_;
+
+	size_t size_;
+};
+
+/// Copy data of leaf into out, where constants are
+/// broadcast to whatever shape the slot has
+static void load (GenericData& out, ade::iLeaf* leaf)
+{
+	if (auto cst = dynamic_cast<const Constant*>(leaf))
+	{
+		cst->fill(out);
+		return;
+	}
+	out.copyover((const char*) leaf->data(),
+		(age::_GENERATED_DTYPE) leaf->type_code());
+}
+
+Plan::Plan (ade::TensptrT root, age::_GENERATED_DTYPE dtype) :
+	root_(root), dtype_(dtype)
+{
+	if (nullptr == root)
+	{
+		logs::fatal("cannot plan evaluation of null tensor");
+	}
+	compile(root.get(), dtype);
+	// compiled_ references graph nodes only needed while compiling
+	compiled_.clear();
+	plan_memory();
+
+	consumers_ = std::vector<std::vector<size_t>>(slots_.size());
+	for (size_t i = 0, n = instrs_.size(); i < n; ++i)
+	{
+		for (size_t in : instrs_[i].in_)
+		{
+			std::vector<size_t>& consumers = consumers_[in];
+			if (consumers.empty() || consumers.back() != i)
+			{
+				consumers.push_back(i);
+			}
+		}
+	}
+}
+
+GenericData Plan::run (void)
+{
+	std::vector<GenericData> results(slots_.size());
+	size_t root_slot = slots_.size() - 1;
+	for (Instruction& instr : instrs_)
+	{
+		GenericData& slot = slots_[instr.out_];
+		GenericData out;
+		if (root_slot == instr.out_)
+		{
+			out = GenericData(slot.shape_, slot.dtype_);
+		}
+		else
+		{
+			out = slot;
+			out.data_ = std::shared_ptr<char>(arena_,
+				arena_.get() + offsets_[instr.out_]);
+		}
+		if (nullptr != instr.leaf_)
+		{
+			load(out, instr.leaf_);
+		}
+		else
+		{
+			for (size_t i = 0, n = instr.in_.size(); i < n; ++i)
+			{
+				instr.args_[i].data_ = results[instr.in_[i]].data_;
+			}
+			if (nullptr != instr.fused_)
+			{
+				instr.fused_->eval(out.data_.get(), out.dtype_, instr.args_);
+			}
+			else
+			{
+				op_exec(instr.opcode_, out.dtype_,
+					out.data_.get(), out.shape_, instr.args_);
+			}
+			for (DataArg& arg : instr.args_)
+			{
+				arg.data_ = nullptr;
+			}
+		}
+		results[instr.out_] = out;
+	}
+	return results.back();
+}
+
+/// Random operators share one engine, which is not thread-safe
+static std::mutex rand_mutex;
+
+GenericData Plan::run (ThreadPool& pool)
+{
+	size_t n = instrs_.size();
+	std::vector<GenericData> results(n);
+	// number of unfinished distinct inputs of every instruction
+	std::unique_ptr<std::atomic<size_t>[]> nwaiting(
+		new std::atomic<size_t>[n]);
+	for (size_t i = 0; i < n; ++i)
+	{
+		std::vector<size_t> ins = instrs_[i].in_;
+		std::sort(ins.begin(), ins.end());
+		nwaiting[i] = std::unique(ins.begin(), ins.end()) - ins.begin();
+	}
+	// number of consumers yet to read every slot
+	std::unique_ptr<std::atomic<size_t>[]> nreaders(
+		new std::atomic<size_t>[n]);
+	for (size_t i = 0; i < n; ++i)
+	{
+		nreaders[i] = consumers_[i].size();
+	}
+	std::atomic<size_t> nremaining(n);
+	std::atomic<bool> failed(false);
+	std::exception_ptr error;
+	std::mutex error_mutex;
+
+	std::function<void(size_t)> exec =
+		[&](size_t i)
+		{
+			const Instruction& instr = instrs_[i];
+			// after a failure, instructions are skipped but still
+			// complete so the caller stops waiting
+			if (false == failed) try
+			{
+				const GenericData& slot = slots_[instr.out_];
+				GenericData out(slot.shape_, slot.dtype_);
+				if (nullptr != instr.leaf_)
+				{
+					load(out, instr.leaf_);
+				}
+				else
+				{
+					// arguments are copied so instructions stay unchanged
+					// and concurrent runs never read each other's inputs
+					DataArgsT args = instr.args_;
+					for (size_t j = 0, nargs = instr.in_.size(); j < nargs; ++j)
+					{
+						args[j].data_ = results[instr.in_[j]].data_;
+					}
+					if (nullptr != instr.fused_)
+					{
+						instr.fused_->eval(out.data_.get(), out.dtype_, args);
+					}
+					else if (age::RAND_BINO == instr.opcode_ ||
+						age::RAND_UNIF == instr.opcode_ ||
+						age::RAND_NORM == instr.opcode_)
+					{
+						std::lock_guard<std::mutex> lock(rand_mutex);
+						op_exec(instr.opcode_, out.dtype_,
+							out.data_.get(), out.shape_, args);
+					}
+					else
+					{
+						op_exec(instr.opcode_, out.dtype_,
+							out.data_.get(), out.shape_, args);
+					}
+				}
+				results[instr.out_] = out;
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(error_mutex);
+				if (false == failed.exchange(true))
+				{
+					error = std::current_exception();
+				}
+			}
+
+			// release inputs once every consumer has read them
+			std::vector<size_t> ins = instr.in_;
+			std::sort(ins.begin(), ins.end());
+			ins.erase(std::unique(ins.begin(), ins.end()), ins.end());
+			for (size_t in : ins)
+			{
+				if (1 == nreaders[in]--)
+				{
+					results[in].data_ = nullptr;
+				}
+			}
+			for (size_t consumer : consumers_[instr.out_])
+			{
+				if (1 == nwaiting[consumer]--)
+				{
+					pool.submit([&exec, consumer]() { exec(consumer); });
+				}
+			}
+			pool.count_down(nremaining);
+		};
+
+	// gather before submitting, since running instructions
+	// decrement nwaiting and submit consumers themselves
+	std::vector<size_t> ready;
+	for (size_t i = 0; i < n; ++i)
+	{
+		if (0 == nwaiting[i])
+		{
+			ready.push_back(i);
+		}
+	}
+	for (size_t i : ready)
+	{
+		pool.submit([&exec, i]() { exec(i); });
+	}
+	pool.wait(nremaining);
+	if (failed)
+	{
+		std::rethrow_exception(error);
+	}
+	return results.back();
+}
+
+size_t Plan::compile (ade::iTensor* tens, age::_GENERATED_DTYPE dtype,
+	bool single)
+{
+	auto key = std::make_tuple(tens, dtype, single);
+	auto it = compiled_.find(key);
+	if (compiled_.end() != it)
+	{
+		return it->second;
+	}
+
+	Instruction instr{nullptr, age::BAD_OP, nullptr, 0, {}, {}};
+	if (ade::iFunctor* func = dynamic_cast<ade::iFunctor*>(tens))
+	{
+		instr.opcode_ = (age::_GENERATED_OPCODE) func->get_opcode().code_;
+		instr.fused_ = dynamic_cast<const FusedFunctor*>(func);
+		const ade::ArgsT& children = func->get_children();
+		size_t nargs = children.size();
+		if (age::RAND_BINO == instr.opcode_ && nargs != 2)
+		{
+			logs::fatalf("cannot RAND_BINO without exactly 2 arguments: "
+				"using %d arguments", nargs);
+		}
+		for (size_t i = 0; i < nargs; ++i)
+		{
+			const ade::MappedTensor& child = children[i];
+			// RAND_BINO probabilities are always evaluated as doubles
+			age::_GENERATED_DTYPE argtype =
+				age::RAND_BINO == instr.opcode_ && 1 == i ? age::DOUBLE : dtype;
+			ade::iTensor* ctens = child.get_tensor().get();
+			bool bcast = nullptr != dynamic_cast<Constant*>(ctens) &&
+				can_broadcast(instr.opcode_, child);
+			size_t in = compile(ctens, argtype, bcast);
+			instr.in_.push_back(in);
+			instr.args_.push_back(DataArg{
+				nullptr,
+				slots_[in].shape_,
+				bcast ? broadcast : child.get_coorder(),
+				bcast ? false : child.map_io(),
+			});
+		}
+	}
+	else
+	{
+		instr.leaf_ = static_cast<ade::iLeaf*>(tens);
+	}
+
+	// slots are numbered in order of instructions, so the last slot is root
+	instr.out_ = slots_.size();
+	GenericData slot;
+	slot.shape_ = single ? ade::Shape() : tens->shape();
+	slot.dtype_ = dtype;
+	slots_.push_back(slot);
+	instrs_.push_back(instr);
+	compiled_.emplace(key, instr.out_);
+	return instr.out_;
+}
+
+void Plan::plan_memory (void)
+{
+	size_t nslots = slots_.size();
+	size_t root_slot = nslots - 1;
+	// index of the last instruction reading each slot
+	std::vector<size_t> last_use(nslots, 0);
+	for (size_t i = 0, n = instrs_.size(); i < n; ++i)
+	{
+		for (size_t in : instrs_[i].in_)
+		{
+			last_use[in] = i;
+		}
+	}
+
+	// free blocks ordered by offset, the arena grows past its last block
+	std::list<Block> frees;
+	offsets_ = std::vector<size_t>(nslots, 0);
+	arena_size_ = 0;
+	for (size_t i = 0, n = instrs_.size(); i < n; ++i)
+	{
+		size_t out = instrs_[i].out_;
+		if (root_slot != out)
+		{
+			GenericData& slot = slots_[out];
+			size_t nbytes = slot.shape_.n_elems() * type_size(slot.dtype_);
+			nbytes = (nbytes + slot_align - 1) / slot_align * slot_align;
+
+			// allocate output before releasing inputs
+			// so kernels never write to a buffer they read from
+			auto best = frees.end();
+			for (auto it = frees.begin(), et = frees.end(); it != et; ++it)
+			{
+				if (it->size_ >= nbytes &&
+					(frees.end() == best || it->size_ < best->size_))
+				{
+					best = it;
+				}
+			}
+			if (frees.end() != best)
+			{
+				offsets_[out] = best->offset_;
+				best->offset_ += nbytes;
+				best->size_ -= nbytes;
+				if (0 == best->size_)
+				{
+					frees.erase(best);
+				}
+			}
+			else if (false == frees.empty() &&
+				frees.back().offset_ + frees.back().size_ == arena_size_)
+			{
+				// extend the trailing free block to fit
+				offsets_[out] = frees.back().offset_;
+				arena_size_ = offsets_[out] + nbytes;
+				frees.pop_back();
+			}
+			else
+			{
+				offsets_[out] = arena_size_;
+				arena_size_ += nbytes;
+			}
+		}
+
+		for (size_t in : instrs_[i].in_)
+		{
+			if (last_use[in] != i)
+			{
+				continue;
+			}
+			// an input can appear multiple times in the same instruction
+			last_use[in] = instrs_.size();
+			GenericData& slot = slots_[in];
+			size_t nbytes = slot.shape_.n_elems() * type_size(slot.dtype_);
+			nbytes = (nbytes + slot_align - 1) / slot_align * slot_align;
+			Block freed{offsets_[in], nbytes};
+			auto it = frees.begin();
+			while (frees.end() != it && it->offset_ < freed.offset_)
+			{
+				++it;
+			}
+			it = frees.insert(it, freed);
+			// coalesce with neighbors
+			auto next = std::next(it);
+			if (frees.end() != next && it->offset_ + it->size_ == next->offset_)
+			{
+				it->size_ += next->size_;
+				frees.erase(next);
+			}
+			if (frees.begin() != it)
+			{
+				auto prev = std::prev(it);
+				if (prev->offset_ + prev->size_ == it->offset_)
+				{
+					prev->size_ += it->size_;
+					frees.erase(it);
+				}
+			}
+		}
+	}
+	// malloc only guarantees alignment for fundamental types,
+	// so align the base for slot offsets to be aligned too
+	void* base = nullptr;
+	if (0 != posix_memalign(&base, slot_align,
+		std::max(arena_size_, slot_align)))
+	{
+		logs::fatalf("failed to allocate arena of %d bytes", arena_size_);
+	}
+	arena_ = std::shared_ptr<char>((char*) base, [](char* p) { free(p); });
+}
+
+}
+
+#endif
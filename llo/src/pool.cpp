@@ -0,0 +1,228 @@
+#include <algorithm>
+
+#include "llo/pool.hpp"
+
+#ifdef LLO_POOL_HPP
+
+namespace llo
+{
+
+/// Pool owning the current thread if the thread is a worker
+static thread_local ThreadPool* local_pool = nullptr;
+
+/// Index of the current thread's deque in local_pool
+static thread_local size_t local_index = 0;
+
+ThreadPool::ThreadPool (size_t nthreads) :
+	npending_(0), next_(0), stop_(false)
+{
+	if (0 == nthreads)
+	{
+		nthreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	for (size_t i = 0; i < nthreads; ++i)
+	{
+		workers_.push_back(std::unique_ptr<Worker>(new Worker()));
+	}
+	for (size_t i = 0; i < nthreads; ++i)
+	{
+		threads_.push_back(std::thread(&ThreadPool::work, this, i));
+	}
+}
+
+ThreadPool::~ThreadPool (void)
+{
+	{
+		std::lock_guard<std::mutex> lock(idle_mutex_);
+		stop_ = true;
+	}
+	idle_cond_.notify_all();
+	for (std::thread& thread : threads_)
+	{
+		thread.join();
+	}
+}
+
+void ThreadPool::submit (TaskT task)
+{
+	size_t index = this == local_pool ? local_index :
+		next_++ % workers_.size();
+	{
+		// count before pushing so takers never decrement below zero,
+		// increment under idle_mutex_ so sleeping workers can't miss it
+		std::lock_guard<std::mutex> lock(idle_mutex_);
+		++npending_;
+	}
+	{
+		Worker& worker = *workers_[index];
+		std::lock_guard<std::mutex> lock(worker.mutex_);
+		worker.tasks_.push_back(std::move(task));
+	}
+	idle_cond_.notify_one();
+}
+
+bool ThreadPool::run_pending (void)
+{
+	TaskT task;
+	if (false == take(this == local_pool ?
+		local_index : workers_.size(), task))
+	{
+		return false;
+	}
+	task();
+	return true;
+}
+
+void ThreadPool::count_down (std::atomic<size_t>& count)
+{
+	{
+		// decrement under idle_mutex_ so waiters can't miss it
+		std::lock_guard<std::mutex> lock(idle_mutex_);
+		--count;
+	}
+	idle_cond_.notify_all();
+}
+
+void ThreadPool::wait (const std::atomic<size_t>& count)
+{
+	while (count > 0)
+	{
+		if (run_pending())
+		{
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(idle_mutex_);
+		idle_cond_.wait(lock,
+			[&]() { return 0 == count || npending_ > 0; });
+	}
+}
+
+bool ThreadPool::take (size_t own, TaskT& out)
+{
+	size_t n = workers_.size();
+	if (own < n)
+	{
+		Worker& worker = *workers_[own];
+		std::lock_guard<std::mutex> lock(worker.mutex_);
+		if (false == worker.tasks_.empty())
+		{
+			out = std::move(worker.tasks_.back());
+			worker.tasks_.pop_back();
+			--npending_;
+			return true;
+		}
+	}
+	size_t start = own < n ? own + 1 : 0;
+	for (size_t i = 0; i < n; ++i)
+	{
+		Worker& victim = *workers_[(start + i) % n];
+		std::lock_guard<std::mutex> lock(victim.mutex_);
+		if (false == victim.tasks_.empty())
+		{
+			out = std::move(victim.tasks_.front());
+			victim.tasks_.pop_front();
+			--npending_;
+			return true;
+		}
+	}
+	return false;
+}
+
+void ThreadPool::work (size_t index)
+{
+	local_pool = this;
+	local_index = index;
+	TaskT task;
+	while (true)
+	{
+		if (take(index, task))
+		{
+			task();
+			task = nullptr;
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(idle_mutex_);
+		idle_cond_.wait(lock,
+			[this]() { return stop_ || npending_ > 0; });
+		if (stop_ && 0 == npending_)
+		{
+			return;
+		}
+	}
+}
+
+ThreadPool& get_pool (void)
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+ParallelConfig& get_parallel_config (void)
+{
+	static ParallelConfig config;
+	return config;
+}
+
+void parallel_for (size_t n, std::function<void(size_t,size_t)> f)
+{
+	parallel_for(n, 1, f);
+}
+
+void parallel_for (size_t n, size_t cost,
+	std::function<void(size_t,size_t)> f)
+{
+	const ParallelConfig& config = get_parallel_config();
+	cost = std::max(cost, (size_t) 1);
+	if (n * cost < std::max(config.threshold_, (size_t) 1))
+	{
+		f(0, n);
+		return;
+	}
+	ThreadPool& pool = get_pool();
+	// callers count as a worker
+	size_t nworkers = pool.nthreads() + 1;
+	size_t grain = std::max(config.grain_ / cost, (size_t) 1);
+	size_t nchunks = std::min((n + grain - 1) / grain, nworkers);
+	if (nchunks < 2)
+	{
+		f(0, n);
+		return;
+	}
+	size_t chunk = (n + nchunks - 1) / nchunks;
+	nchunks = (n + chunk - 1) / chunk;
+
+	std::atomic<size_t> nremaining(nchunks);
+	std::exception_ptr error;
+	std::mutex error_mutex;
+	auto run_chunk =
+		[&](size_t begin)
+		{
+			try
+			{
+				f(begin, std::min(begin + chunk, n));
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(error_mutex);
+				if (nullptr == error)
+				{
+					error = std::current_exception();
+				}
+			}
+			pool.count_down(nremaining);
+		};
+	for (size_t begin = chunk; begin < n; begin += chunk)
+	{
+		pool.submit([&run_chunk, begin]() { run_chunk(begin); });
+	}
+	run_chunk(0);
+	pool.wait(nremaining);
+	if (nullptr != error)
+	{
+		std::rethrow_exception(error);
+	}
+}
+
+}
+
+#endif
@@ -1,5 +1,6 @@
 #include "ade/ileaf.hpp"
 
+#include "llo/fold.hpp"
 #include "llo/serialize.hpp"
 
 #ifdef LLO_SERIALIZE_HPP
@@ -7,7 +8,7 @@
 namespace llo
 {
 
-bool is_big_endian(void)
+bool is_big_endian (void)
 {
 	union
 	{
@@ -36,24 +37,78 @@ std::string serialize (const char* in, size_t nelems, size_t typecode)
 	return std::string(in, nelems * nbytes);
 }
 
+pbm::LeafInfo leaf_info (ade::iLeaf* leaf)
+{
+	pbm::LeafInfo info;
+	info.constant_ = is_constant(leaf);
+	if (auto cst = dynamic_cast<Constant*>(leaf))
+	{
+		info.value_ = cst->value();
+	}
+	return info;
+}
+
 ade::TensptrT deserialize (const char* pb, ade::Shape shape,
-	size_t typecode, std::string label)
+	size_t typecode, std::string label, pbm::LeafInfo info)
 {
+	bool scalar = nullptr != info.value_;
 	age::_GENERATED_DTYPE gencode = (age::_GENERATED_DTYPE) typecode;
 	size_t nbytes = age::type_size(gencode);
+	std::string swapped;
 	if (is_big_endian() && nbytes > 1)
 	{
-		size_t totalbytes = shape.n_elems() * nbytes;
-		std::string out(totalbytes, '\0');
+		size_t totalbytes = (scalar ? 1 : shape.n_elems()) * nbytes;
+		swapped = std::string(totalbytes, '\0');
 		for (size_t i = 0; i < totalbytes; ++i)
 		{
 			size_t elemi = i / nbytes;
 			size_t outi = (elemi + 1) * nbytes - (i % nbytes);
-			out[outi] = pb[i];
+			swapped[outi] = pb[i];
 		}
-		return ade::TensptrT(new Variable(out.c_str(), gencode, shape, label));
+		pb = swapped.c_str();
+	}
+	if (scalar)
+	{
+		return ade::TensptrT(new Constant(pb, gencode, shape, label));
+	}
+	VarptrT out(new Variable(pb, gencode, shape, label));
+	out->constant_ = info.constant_;
+	return out;
+}
+
+Variable* LazyVariable::get_var (void) const
+{
+	std::call_once(fetched_,
+		[this]()
+		{
+			std::string pb = fetch_();
+			size_t nbytes = shape_.n_elems() *
+				age::type_size((age::_GENERATED_DTYPE) typecode_);
+			if (pb.size() < nbytes)
+			{
+				logs::fatalf("cannot unmarshal %d bytes as %s of shape %s",
+					pb.size(), age::name_type(
+						(age::_GENERATED_DTYPE) typecode_).c_str(),
+					shape_.to_string().c_str());
+			}
+			pbm::LeafInfo info;
+			info.constant_ = constant_;
+			var_ = deserialize(pb.c_str(), shape_, typecode_, label_, info);
+			fetch_ = FetchT();
+		});
+	return static_cast<Variable*>(var_.get());
+}
+
+ade::TensptrT lazy_deserialize (FetchT fetch, ade::Shape shape,
+	size_t typecode, std::string label, pbm::LeafInfo info)
+{
+	if (nullptr != info.value_)
+	{
+		// single values are already loaded, so there is nothing to defer
+		return deserialize(info.value_, shape, typecode, label, info);
 	}
-	return ade::TensptrT(new Variable(pb, gencode, shape, label));
+	return ade::TensptrT(new LazyVariable(fetch, shape, typecode, label,
+		info.constant_));
 }
 
 }
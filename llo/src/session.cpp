@@ -0,0 +1,104 @@
+#include "llo/serialize.hpp"
+#include "llo/session.hpp"
+
+#ifdef LLO_SESSION_HPP
+
+namespace llo
+{
+
+/// Return Variable holding the data of leaf tens, which is the fetched
+/// Variable of LazyVariables once loaded, otherwise return null
+static Variable* leaf_variable (ade::iTensor* tens)
+{
+	if (auto lazy = dynamic_cast<LazyVariable*>(tens))
+	{
+		return lazy->is_loaded() ? lazy->get_var() : nullptr;
+	}
+	return dynamic_cast<Variable*>(tens);
+}
+
+Session::Session (ade::TensptrT root, age::_GENERATED_DTYPE dtype) :
+	root_(root), evaler_(dtype)
+{
+	if (nullptr == root)
+	{
+		logs::fatal("cannot evaluate null tensor");
+	}
+	sort(root.get());
+	versions_ = std::vector<size_t>(order_.size(), 0);
+}
+
+GenericData Session::run (void)
+{
+	std::vector<char> dirty(order_.size(), false);
+	for (size_t i = 0, n = order_.size(); i < n; ++i)
+	{
+		ade::iTensor* tens = order_[i];
+		if (auto func = dynamic_cast<ade::iFunctor*>(tens))
+		{
+			dirty[i] = is_random(func);
+			for (size_t child : children_[i])
+			{
+				dirty[i] = dirty[i] || dirty[child];
+			}
+		}
+		else if (auto var = leaf_variable(tens))
+		{
+			dirty[i] = var->version_ != versions_[i];
+			versions_[i] = var->version_;
+		}
+		else
+		{
+			// constants never change, unfetched lazy leaves have no results
+			// to reuse, and other leaves are never trusted
+			dirty[i] = nullptr == dynamic_cast<Constant*>(tens);
+		}
+		if (dirty[i])
+		{
+			evaler_.results_.erase(tens);
+		}
+	}
+	root_->accept(evaler_);
+	if (auto cst = dynamic_cast<Constant*>(root_.get()))
+	{
+		GenericData full(cst->shape(), evaler_.out_.dtype_);
+		cst->fill(full);
+		return full;
+	}
+	return evaler_.out_;
+}
+
+GenericData Session::get_result (ade::iTensor* tens) const
+{
+	auto it = evaler_.results_.find(tens);
+	if (evaler_.results_.end() == it)
+	{
+		return GenericData();
+	}
+	return it->second;
+}
+
+void Session::sort (ade::iTensor* tens)
+{
+	if (indices_.end() != indices_.find(tens))
+	{
+		return;
+	}
+	std::vector<size_t> children;
+	if (auto func = dynamic_cast<ade::iFunctor*>(tens))
+	{
+		for (const ade::MappedTensor& child : func->get_children())
+		{
+			ade::iTensor* ctens = child.get_tensor().get();
+			sort(ctens);
+			children.push_back(indices_[ctens]);
+		}
+	}
+	indices_.emplace(tens, order_.size());
+	order_.push_back(tens);
+	children_.push_back(children);
+}
+
+}
+
+#endif
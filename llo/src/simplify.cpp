@@ -0,0 +1,115 @@
+#include "llo/generated/codes.hpp"
+
+#include "llo/fold.hpp"
+#include "llo/fused.hpp"
+#include "llo/simplify.hpp"
+#include "llo/stride.hpp"
+
+#ifdef LLO_SIMPLIFY_HPP
+
+namespace llo
+{
+
+/// Return true if arg maps its tensor without changing shape or order
+static bool is_identity (const ade::MappedTensor& arg)
+{
+	return is_identity(*arg.get_shaper()) && is_identity(*arg.get_coorder());
+}
+
+/// Return grandchild of func if func's only child is a functor of opcode
+/// and both are identity-mapped, otherwise return nullptr
+static ade::TensptrT unwrap (ade::iFunctor* func,
+	age::_GENERATED_OPCODE opcode)
+{
+	const ade::MappedTensor& arg = func->get_children()[0];
+	auto child = dynamic_cast<ade::iFunctor*>(arg.get_tensor().get());
+	if (false == is_identity(arg) || nullptr == child ||
+		opcode != child->get_opcode().code_)
+	{
+		return nullptr;
+	}
+	const ade::MappedTensor& grandarg = child->get_children()[0];
+	if (false == is_identity(grandarg))
+	{
+		return nullptr;
+	}
+	return grandarg.get_tensor();
+}
+
+/// Return first argument of binary func if the second argument is 1
+static ade::TensptrT drop_unit_right (ade::iFunctor* func)
+{
+	const ade::ArgsT& args = func->get_children();
+	if (is_constant_value(args[1].get_tensor().get(), 1) &&
+		is_identity(args[0]))
+	{
+		return args[0].get_tensor();
+	}
+	return nullptr;
+}
+
+opt::RulesT simplify_rules (void)
+{
+	opt::RulesT rules;
+	rules[age::NEG].push_back(
+		[](ade::iFunctor* func)
+		{
+			return unwrap(func, age::NEG);
+		});
+	rules[age::EXP].push_back(
+		[](ade::iFunctor* func)
+		{
+			return unwrap(func, age::LOG);
+		});
+	rules[age::POW].push_back(drop_unit_right);
+	rules[age::DIV].push_back(drop_unit_right);
+	rules[age::PROD].push_back(
+		[](ade::iFunctor* func) -> ade::TensptrT
+		{
+			const ade::ArgsT& args = func->get_children();
+			ade::ArgsT filtered;
+			for (const ade::MappedTensor& arg : args)
+			{
+				if (false == is_constant_value(arg.get_tensor().get(), 1))
+				{
+					filtered.push_back(arg);
+				}
+			}
+			if (filtered.size() == args.size())
+			{
+				return nullptr;
+			}
+			if (filtered.empty())
+			{
+				return ade::TensptrT(llo::get_scalar(1, func->shape()));
+			}
+			if (1 == filtered.size() && is_identity(filtered[0]))
+			{
+				return filtered[0].get_tensor();
+			}
+			return ade::TensptrT(
+				ade::Functor::get(func->get_opcode(), filtered));
+		});
+	rules[age::SUB].push_back(
+		[](ade::iFunctor* func) -> ade::TensptrT
+		{
+			const ade::ArgsT& args = func->get_children();
+			if (args[0].get_tensor() == args[1].get_tensor() &&
+				is_identity(args[0]) && is_identity(args[1]))
+			{
+				return ade::TensptrT(llo::get_scalar(0, func->shape()));
+			}
+			return nullptr;
+		});
+	return rules;
+}
+
+ade::TensptrT simplify (ade::TensptrT root)
+{
+	opt::Rewriter rewriter(simplify_rules(), rebuild);
+	return rewriter.rewrite(root);
+}
+
+}
+
+#endif
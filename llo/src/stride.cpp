@@ -0,0 +1,115 @@
+#include <limits>
+
+#include "llo/stride.hpp"
+
+#ifdef LLO_STRIDE_HPP
+
+namespace llo
+{
+
+StrideIndexer::StrideIndexer (const ade::iCoordMap& mapper,
+	const ade::Shape& src, const ade::Shape& dest)
+{
+	using CoordValT = ade::CoordT::value_type;
+	mapper.access(
+	[&](const ade::MatrixT& m)
+	{
+		// only handle maps without projective components
+		for (uint8_t i = 0; i < ade::rank_cap; ++i)
+		{
+			if (m[i][ade::rank_cap] != 0)
+			{
+				return;
+			}
+		}
+		if (m[ade::rank_cap][ade::rank_cap] != 1)
+		{
+			return;
+		}
+		// every output dimension must depend on at most one input dimension
+		std::array<int,ade::rank_cap> srcdim;
+		for (uint8_t i = 0; i < ade::rank_cap; ++i)
+		{
+			srcdim[i] = -1;
+			for (uint8_t j = 0; j < ade::rank_cap; ++j)
+			{
+				if (m[j][i] != 0)
+				{
+					if (srcdim[i] >= 0)
+					{
+						return;
+					}
+					srcdim[i] = j;
+				}
+			}
+		}
+
+		std::array<ade::NElemT,ade::rank_cap> strides;
+		ade::NElemT stride = 1;
+		for (uint8_t i = 0; i < ade::rank_cap; ++i)
+		{
+			strides[i] = stride;
+			stride *= dest.at(i);
+		}
+
+		// convert mapped coordinates exactly like forward,
+		// rejecting values whose conversion is undefined
+		ade::NElemT base = 0;
+		std::array<std::vector<ade::NElemT>,ade::rank_cap> tables;
+		for (uint8_t j = 0; j < ade::rank_cap; ++j)
+		{
+			tables[j] = std::vector<ade::NElemT>(src.at(j), 0);
+		}
+		for (uint8_t i = 0; i < ade::rank_cap; ++i)
+		{
+			double trans = m[ade::rank_cap][i];
+			if (srcdim[i] < 0)
+			{
+				if (trans < 0 || trans > std::numeric_limits<CoordValT>::max())
+				{
+					return;
+				}
+				base += strides[i] * (CoordValT) trans;
+				continue;
+			}
+			uint8_t j = srcdim[i];
+			for (size_t c = 0, n = src.at(j); c < n; ++c)
+			{
+				double v = trans + m[j][i] * c;
+				if (v < 0 || v > std::numeric_limits<CoordValT>::max())
+				{
+					return;
+				}
+				tables[j][c] += strides[i] * (CoordValT) v;
+			}
+		}
+		base_ = base;
+		tables_ = std::move(tables);
+		valid_ = true;
+	});
+}
+
+bool is_identity (const ade::iCoordMap& mapper)
+{
+	if (ade::identity.get() == &mapper)
+	{
+		return true;
+	}
+	bool ident = true;
+	mapper.access(
+		[&](const ade::MatrixT& mat)
+		{
+			for (uint8_t i = 0; i < ade::mat_dim; ++i)
+			{
+				for (uint8_t j = 0; j < ade::mat_dim; ++j)
+				{
+					ident = ident && mat[i][j] == (i == j ? 1 : 0);
+				}
+			}
+		});
+	return ident;
+}
+
+}
+
+#endif
@@ -1,8 +1,11 @@
+#include <algorithm>
 #include <list>
-#include <cassert>
 
 #include "ade/functor.hpp"
 
+#include "llo/cse.hpp"
+#include "llo/fold.hpp"
+#include "llo/fused.hpp"
 #include "llo/zprune.hpp"
 
 #ifdef LLO_ZPRUNE_HPP
@@ -27,6 +30,10 @@ static ade::TensptrT prune0 (ade::iFunctor* func,
 			case age::SQRT:
 			case age::ROUND:
 			case age::PROD:
+			case age::MATMUL:
+			case age::CONV2D:
+			case age::CONV2D_IMGGRAD:
+			case age::CONV2D_KERNGRAD:
 				return ade::TensptrT(llo::get_scalar(0, func->shape()));
 			case age::COS:
 			case age::EXP:
@@ -93,26 +100,142 @@ static ade::TensptrT prune0 (ade::iFunctor* func,
 
 ade::TensptrT zero_prune (ade::TensptrT root)
 {
-	opt::TargetPruner<std::string> zpruner("0",
-		[](ade::iLeaf* leaf) -> std::string
+	return zero_prune(ade::TensT{root})[0];
+}
+
+ade::TensT zero_prune (ade::TensT roots)
+{
+	opt::TargetPruner<bool> zpruner(true,
+		[](ade::iLeaf* leaf) -> bool
 		{
-			auto data = static_cast<Variable*>(leaf);
-			if (nullptr == data)
-			{
-				return "";
-			}
-			return data->label_;
+			return is_constant_value(leaf, 0);
 		}, prune0);
-	return zpruner.prune(root);
+	return zpruner.prune(roots);
 }
 
 ade::TensptrT derive (ade::TensptrT root, ade::iTensor* target)
 {
-	age::Grader grader(target, std::make_shared<age::RuleSet>());
-	root->accept(grader);
-	auto it = grader.derivatives_.find(root.get());
-	assert(grader.derivatives_.end() != it);
-	return zero_prune(it->second);
+	return derive(root, std::vector<ade::iTensor*>{target})[target];
+}
+
+/// Collect indices of children leading to any target for every functor
+/// in paths, return true if tens is or leads to a target
+static bool find_paths (ade::iTensor* tens,
+	const std::unordered_set<ade::iTensor*>& targets,
+	std::unordered_map<ade::iTensor*,bool>& leads,
+	opt::ParentMapT& paths)
+{
+	auto it = leads.find(tens);
+	if (leads.end() != it)
+	{
+		return it->second;
+	}
+	bool lead = targets.end() != targets.find(tens);
+	if (auto func = dynamic_cast<ade::iFunctor*>(tens))
+	{
+		const ade::ArgsT& children = func->get_children();
+		std::unordered_set<size_t> path;
+		for (size_t i = 0, n = children.size(); i < n; ++i)
+		{
+			// continue past targets, since they can lead to other targets
+			if (find_paths(children[i].get_tensor().get(),
+				targets, leads, paths))
+			{
+				path.emplace(i);
+			}
+		}
+		if (false == path.empty())
+		{
+			paths.emplace(func, path);
+			lead = true;
+		}
+	}
+	leads.emplace(tens, lead);
+	return lead;
+}
+
+GradsT derive (ade::TensptrT root, std::vector<ade::iTensor*> targets)
+{
+	age::RuleSet rules;
+	std::unordered_set<ade::iTensor*> tset(targets.begin(), targets.end());
+	std::unordered_map<ade::iTensor*,bool> leads;
+	opt::ParentMapT paths;
+	find_paths(root.get(), tset, leads, paths);
+
+	// parents are visited after every consumer, since a consumer's
+	// graph is always larger than its children's
+	ade::GraphStat stat;
+	root->accept(stat);
+	std::vector<ade::iFunctor*> parents;
+	for (auto& path : paths)
+	{
+		parents.push_back(static_cast<ade::iFunctor*>(path.first));
+	}
+	std::sort(parents.begin(), parents.end(),
+		[&](ade::iFunctor* a, ade::iFunctor* b)
+		{
+			return stat.graphsize_[a] > stat.graphsize_[b];
+		});
+
+	// sum of gradients accumulated for tens
+	std::unordered_map<ade::iTensor*,ade::TensT> grads = {
+		{root.get(), {rules.data(1, root->shape())}},
+	};
+	auto total = [&](ade::iTensor* tens) -> ade::TensptrT
+	{
+		ade::TensT& gargs = grads[tens];
+		if (gargs.empty())
+		{
+			return rules.data(0, tens->shape());
+		}
+		if (1 == gargs.size())
+		{
+			return gargs[0];
+		}
+		ade::ArgsT args;
+		for (ade::TensptrT& garg : gargs)
+		{
+			args.push_back(ade::identity_map(garg));
+		}
+		return ade::TensptrT(ade::Functor::get(rules.sum_opcode(), args));
+	};
+	for (ade::iFunctor* parent : parents)
+	{
+		ade::TensptrT bwd = total(parent);
+		const ade::ArgsT& children = parent->get_children();
+		ade::TensT args;
+		for (const ade::MappedTensor& child : children)
+		{
+			args.push_back(child.get_tensor());
+		}
+		for (size_t i : paths[parent])
+		{
+			const ade::MappedTensor& child = children[i];
+			ade::MappedTensor lhs(bwd,
+				ade::CoordptrT(child.get_shaper()->reverse()),
+				!child.map_io(), child.get_coorder());
+			grads[child.get_tensor().get()].push_back(
+				rules.chain_rule(parent, lhs, args, i));
+		}
+	}
+
+	// prune every gradient in one pass over their shared subgraphs
+	ade::TensT totals;
+	for (ade::iTensor* target : targets)
+	{
+		totals.push_back(total(target));
+	}
+	ade::TensT pruned = zero_prune(totals);
+
+	// pruning rebuilds every gradient separately,
+	// so merge them back into shared subgraphs
+	opt::CSE cse(constant_key, is_mergeable, rebuild, equal_constants);
+	GradsT out;
+	for (size_t i = 0, n = targets.size(); i < n; ++i)
+	{
+		out.emplace(targets[i], cse.merge(pruned[i]));
+	}
+	return out;
 }
 
 }
@@ -0,0 +1,98 @@
+///
+/// stride.hpp
+/// llo
+///
+/// Purpose:
+/// Define precomputed index mapping for coordinate maps whose output
+/// dimensions each depend on at most one input dimension (permute,
+/// extend, reduce, flip, etc.), avoiding per-element matrix products
+///
+
+#include <array>
+#include <vector>
+
+#include "ade/coord.hpp"
+
+#ifndef LLO_STRIDE_HPP
+#define LLO_STRIDE_HPP
+
+namespace llo
+{
+
+/// Map flat indices of src shape to flat indices of dest shape under mapper
+/// Mapped index of source coordinate c is base_ + sum of tables_[d][c[d]]
+/// for every dimension d, producing the same index as
+/// ade::index(dest, mapper.forward(c)) without floating point operations
+struct StrideIndexer final
+{
+	StrideIndexer (const ade::iCoordMap& mapper,
+		const ade::Shape& src, const ade::Shape& dest);
+
+	/// True if mapper is representable by per-dimension tables,
+	/// otherwise tables are empty and callers must use mapper directly
+	bool valid_ = false;
+
+	/// Mapped index contribution independent of source coordinates
+	ade::NElemT base_ = 0;
+
+	/// Mapped index contribution of every coordinate in every dimension
+	std::array<std::vector<ade::NElemT>,ade::rank_cap> tables_;
+};
+
+/// Return true if mapper maps every coordinate to itself
+bool is_identity (const ade::iCoordMap& mapper);
+
+/// Call f(i, mapped) for every flat index i in [begin, end) of shape,
+/// where mapped[k] is the index of i under indexers[k]
+/// Indexers are walked using a multi-dimensional counter,
+/// so mapped indices are only recomputed on carry
+template <size_t N, typename F>
+void stride_walk (const ade::Shape& shape, ade::NElemT begin, ade::NElemT end,
+	std::array<const StrideIndexer*,N> indexers, F f)
+{
+	if (begin >= end)
+	{
+		return;
+	}
+	std::array<size_t,ade::rank_cap> counter;
+	{
+		ade::CoordT coord = ade::coordinate(shape, begin);
+		std::copy(coord.begin(), coord.end(), counter.begin());
+	}
+	// mapped indices without the contribution of dimension 0
+	std::array<ade::NElemT,N> outer;
+	std::array<ade::NElemT,N> mapped;
+	size_t inner = shape.at(0);
+	for (ade::NElemT i = begin; i < end;)
+	{
+		for (size_t k = 0; k < N; ++k)
+		{
+			outer[k] = indexers[k]->base_;
+			for (uint8_t d = 1; d < ade::rank_cap; ++d)
+			{
+				outer[k] += indexers[k]->tables_[d][counter[d]];
+			}
+		}
+		for (; counter[0] < inner && i < end; ++counter[0], ++i)
+		{
+			for (size_t k = 0; k < N; ++k)
+			{
+				mapped[k] = outer[k] + indexers[k]->tables_[0][counter[0]];
+			}
+			f(i, mapped);
+		}
+		counter[0] = 0;
+		for (uint8_t d = 1; d < ade::rank_cap; ++d)
+		{
+			if (++counter[d] < shape.at(d))
+			{
+				break;
+			}
+			counter[d] = 0;
+		}
+	}
+}
+
+}
+
+#endif // LLO_STRIDE_HPP
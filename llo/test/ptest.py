@@ -98,11 +98,15 @@ class LLOTest(unittest.TestCase):
         ex = llo.derive(out, var)
         ex2 = llo.derive(out, var2)
         ex3 = llo.derive(both, var)
+        all_zero, all_ex, all_ex2 = llo.derive_all(out, [var3, var, var2])
 
         rej = llo.evaluate(zero)
         der = llo.evaluate(ex)
         der2 = llo.evaluate(ex2)
         der3 = llo.evaluate(ex3)
+        all_rej = llo.evaluate(all_zero)
+        all_der = llo.evaluate(all_ex)
+        all_der2 = llo.evaluate(all_ex2)
 
         data0 = np.zeros(shape, dtype=float)
         exdata = derive(0, (data, data2))
@@ -113,6 +117,9 @@ class LLOTest(unittest.TestCase):
         self._array_close(exdata, der)
         self._array_close(exdata2, der2)
         self._array_close(exdata3, der3)
+        self._array_eq(data0, all_rej)
+        self._array_close(exdata, all_der)
+        self._array_close(exdata2, all_der2)
 
     def _common_reduce(self, all_reduce, dim_reduce, tf_reduce):
         shape = [3, 4, 5]
@@ -181,6 +188,36 @@ class LLOTest(unittest.TestCase):
         self._array_eq(data1, out1)
         self._array_eq(data0, out0)
 
+    def test_variable_readonly(self):
+        shape = [3, 4, 5]
+        data = np.random.rand(3, 4, 5) * 234
+        expect = data.copy()
+        var = llo.variable(data, 'var')
+        root = age.neg(var)
+        self._array_eq(-expect, llo.evaluate(root))
+
+        # data shared with var cannot change behind its back
+        self.assertFalse(data.flags.writeable)
+        with self.assertRaises(ValueError):
+            data[0, 0, 0] = 1
+        self._array_eq(-expect, llo.evaluate(root))
+
+        data2 = np.random.rand(3, 4, 5) * 234
+        expect2 = data2.copy()
+        var.assign(data2)
+        self.assertFalse(data2.flags.writeable)
+        with self.assertRaises(ValueError):
+            data2[0, 0, 0] = 1
+        self._array_eq(-expect2, llo.evaluate(root))
+
+        # arrays converted to the variable's type are copied instead
+        idata = (np.random.rand(3, 4, 5) * 234).astype(np.int32)
+        var.assign(idata)
+        self.assertTrue(idata.flags.writeable)
+        expect3 = idata.astype(float)
+        idata[0, 0, 0] = 1
+        self._array_eq(-expect3, llo.evaluate(root))
+
     def test_abs(self):
         shape = [3, 4, 5]
         self._common_unary(shape, age.abs, abs,
@@ -419,11 +456,15 @@ class LLOTest(unittest.TestCase):
         ex = llo.derive(out, var)
         ex2 = llo.derive(out, var2)
         ex3 = llo.derive(both, var)
+        all_zero, all_ex, all_ex2 = llo.derive_all(out, [var3, var, var2])
 
         rej = llo.evaluate(zero)
         der = llo.evaluate(ex)
         der2 = llo.evaluate(ex2)
         der3 = llo.evaluate(ex3)
+        all_rej = llo.evaluate(all_zero)
+        all_der = llo.evaluate(all_ex)
+        all_der2 = llo.evaluate(all_ex2)
 
         data0 = np.zeros(shape, dtype=float)
         tf_grad, tf_grad2 = tf.gradients(tf_out, [tf_var, tf_var2])
@@ -437,6 +478,9 @@ class LLOTest(unittest.TestCase):
         self._array_close(exdata, der)
         self._array_close(exdata2, der2)
         self._array_close(exdata3, der3)
+        self._array_eq(data0, all_rej)
+        self._array_close(exdata, all_der)
+        self._array_close(exdata2, all_der2)
 
     def test_convolution(self):
         padding = "VALID"
@@ -1159,4 +1159,42 @@ TEST(API, RandNormal)
 }
 
 
+TEST(API, DeriveAll)
+{
+	std::vector<ade::DimT> slist = {3, 2};
+	ade::Shape shape(slist);
+	ade::NElemT n = shape.n_elems();
+	std::vector<double> data = {0.2, 0.5, 0.7, 0.1, 0.9, 0.3};
+	std::vector<double> data2 = {0.6, 0.4, 0.8, 0.2, 0.1, 0.5};
+
+	ade::TensptrT x = llo::get_variable<double>(data, shape);
+	ade::TensptrT y = llo::get_variable<double>(data2, shape);
+	ade::TensptrT z = llo::get_variable<double>(data2, shape);
+	// h is both a target and on the paths to x and y
+	ade::TensptrT h = age::mul(x, y);
+	ade::TensptrT dest = age::add(age::sin(h), age::mul(h, x));
+
+	llo::GradsT grads = llo::derive(dest,
+		std::vector<ade::iTensor*>{x.get(), y.get(), h.get(), z.get()});
+	ASSERT_EQ(4, grads.size());
+	llo::GenericData gx = llo::eval(grads[x.get()], age::DOUBLE);
+	llo::GenericData gy = llo::eval(grads[y.get()], age::DOUBLE);
+	llo::GenericData gh = llo::eval(grads[h.get()], age::DOUBLE);
+	llo::GenericData gz = llo::eval(grads[z.get()], age::DOUBLE);
+	double* gxptr = (double*) gx.data_.get();
+	double* gyptr = (double*) gy.data_.get();
+	double* ghptr = (double*) gh.data_.get();
+	double* gzptr = (double*) gz.data_.get();
+	for (size_t i = 0; i < n; ++i)
+	{
+		double a = data[i];
+		double b = data2[i];
+		EXPECT_DOUBLE_EQ(b * std::cos(a * b) + 2 * a * b, gxptr[i]);
+		EXPECT_DOUBLE_EQ(a * std::cos(a * b) + a * a, gyptr[i]);
+		EXPECT_DOUBLE_EQ(std::cos(a * b) + a, ghptr[i]);
+		EXPECT_DOUBLE_EQ(0, gzptr[i]);
+	}
+}
+
+
 #endif // DISABLE_API_TEST
@@ -2,12 +2,17 @@
 #ifndef DISABLE_DATA_TEST
 
 
+#include <fstream>
+
 #include "gtest/gtest.h"
 
 #include "llo/test/common.hpp"
 
 #include "llo/data.hpp"
 #include "llo/eval.hpp"
+#include "llo/fold.hpp"
+#include "llo/mmap.hpp"
+#include "llo/serialize.hpp"
 
 
 TEST(DATA, MismatchSize)
@@ -88,4 +93,154 @@ TEST(DATA, PlaceHolder)
 }
 
 
+TEST(DATA, AdoptBuffer)
+{
+	std::vector<ade::DimT> slist = {3, 2};
+	ade::Shape shape(slist);
+	size_t n = shape.n_elems();
+	bool released = false;
+	double* raw = new double[n]{3, 1, 4, 1, 5, 9};
+	std::shared_ptr<double> buf(raw,
+		[&released](double* p)
+		{
+			released = true;
+			delete[] p;
+		});
+
+	llo::VarptrT var = llo::get_variable<double>(buf, shape);
+	buf.reset();
+	EXPECT_EQ(raw, var->data());
+
+	llo::Evaluator evaler(age::DOUBLE);
+	var->accept(evaler);
+	EXPECT_EQ((char*) raw, evaler.out_.data_.get());
+
+	var.reset();
+	EXPECT_FALSE(released);
+	evaler.results_.clear();
+	evaler.out_ = llo::GenericData();
+	EXPECT_TRUE(released);
+}
+
+
+TEST(DATA, MapVariable)
+{
+	std::vector<ade::DimT> slist = {3, 2};
+	ade::Shape shape(slist);
+	size_t n = shape.n_elems();
+	std::vector<double> data = {2, 7, 1, 8, 2, 8};
+	std::vector<double> data2 = {1, 4, 1, 4, 2, 1};
+	const char* path = "mapped_variable.data";
+	{
+		std::ofstream out(path, std::ios::binary);
+		double header = 0;
+		out.write((const char*) &header, sizeof(double));
+		out.write((const char*) &data[0], n * sizeof(double));
+	}
+
+	llo::VarptrT var = llo::map_variable(path,
+		sizeof(double), shape, age::DOUBLE);
+	llo::GenericData gd = llo::eval(var, age::DOUBLE);
+	double* gotdata = (double*) gd.data_.get();
+	for (size_t i = 0; i < n; ++i)
+	{
+		EXPECT_DOUBLE_EQ(data[i], gotdata[i]);
+	}
+
+	// assignment never writes to the mapped file
+	*var = data2;
+	double* vptr = (double*) var->data();
+	llo::GenericData remapped = llo::map_data(path,
+		sizeof(double), shape, age::DOUBLE);
+	double* rptr = (double*) remapped.data_.get();
+	for (size_t i = 0; i < n; ++i)
+	{
+		EXPECT_DOUBLE_EQ(data2[i], vptr[i]);
+		EXPECT_DOUBLE_EQ(data[i], rptr[i]);
+	}
+
+	// copy on write variables are assigned in place without
+	// writing to the file
+	llo::VarptrT cow = llo::map_variable(path,
+		sizeof(double), shape, age::DOUBLE, "cow", true);
+	void* cowptr = cow->data();
+	*cow = data2;
+	EXPECT_EQ(cowptr, cow->data());
+	double* cptr = (double*) cow->data();
+	llo::GenericData cowfile = llo::map_data(path,
+		sizeof(double), shape, age::DOUBLE);
+	double* fptr = (double*) cowfile.data_.get();
+	for (size_t i = 0; i < n; ++i)
+	{
+		EXPECT_DOUBLE_EQ(data2[i], cptr[i]);
+		EXPECT_DOUBLE_EQ(data[i], fptr[i]);
+	}
+
+	std::stringstream ss;
+	ss << "cannot map " << n * sizeof(double) << " bytes at offset " <<
+		2 * sizeof(double) << " beyond the end of " << path;
+	EXPECT_FATAL(llo::map_data(path, 2 * sizeof(double), shape, age::DOUBLE),
+		ss.str().c_str());
+	std::remove(path);
+}
+
+
+TEST(DATA, LazyVariable)
+{
+	std::vector<ade::DimT> slist = {3, 2};
+	ade::Shape shape(slist);
+	size_t n = shape.n_elems();
+	std::vector<double> data = {1, 6, 1, 8, 0, 3};
+	size_t nfetches = 0;
+	ade::TensptrT lazy = llo::lazy_deserialize(
+		[&]()
+		{
+			++nfetches;
+			return llo::serialize((const char*) &data[0], n, age::DOUBLE);
+		}, shape, age::DOUBLE, "lazy", pbm::LeafInfo());
+	EXPECT_EQ(0, nfetches);
+
+	llo::GenericData gd = llo::eval(lazy, age::DOUBLE);
+	llo::GenericData gd2 = llo::eval(lazy, age::DOUBLE);
+	EXPECT_EQ(1, nfetches);
+	double* gotdata = (double*) gd.data_.get();
+	double* gotdata2 = (double*) gd2.data_.get();
+	for (size_t i = 0; i < n; ++i)
+	{
+		EXPECT_DOUBLE_EQ(data[i], gotdata[i]);
+		EXPECT_DOUBLE_EQ(data[i], gotdata2[i]);
+	}
+
+	// constant flag is known before fetching and kept by the fetched data
+	pbm::LeafInfo info;
+	info.constant_ = true;
+	ade::TensptrT cst = llo::lazy_deserialize(
+		[&]()
+		{
+			++nfetches;
+			return llo::serialize((const char*) &data[0], n, age::DOUBLE);
+		}, shape, age::DOUBLE, "cst", info);
+	auto lazy_cst = dynamic_cast<llo::LazyVariable*>(cst.get());
+	ASSERT_NE(nullptr, lazy_cst);
+	EXPECT_TRUE(llo::is_constant(lazy_cst));
+	EXPECT_EQ(1, nfetches);
+	EXPECT_TRUE(lazy_cst->get_var()->constant_);
+	EXPECT_EQ(2, nfetches);
+
+	// single values are loaded as Constant without fetching
+	double value = 4;
+	std::string pb = llo::serialize((const char*) &value, 1, age::DOUBLE);
+	info.value_ = pb.c_str();
+	ade::TensptrT scalar = llo::lazy_deserialize(
+		[&]()
+		{
+			++nfetches;
+			return pb;
+		}, shape, age::DOUBLE, "scalar", info);
+	EXPECT_EQ(2, nfetches);
+	ASSERT_NE(nullptr, dynamic_cast<llo::Constant*>(scalar.get()));
+	EXPECT_TRUE(llo::is_constant_value(scalar.get(), 4));
+}
+
+
 #endif // DISABLE_DATA_TEST
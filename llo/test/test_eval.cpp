@@ -0,0 +1,758 @@
+
+#ifndef DISABLE_EVAL_TEST
+
+
+#include <future>
+
+#include "gtest/gtest.h"
+
+#include "llo/test/common.hpp"
+
+#include "llo/generated/api.hpp"
+
+#include "llo/compose.hpp"
+#include "llo/cse.hpp"
+#include "llo/eval.hpp"
+#include "llo/helper.hpp"
+#include "llo/fold.hpp"
+#include "llo/fused.hpp"
+#include "llo/plan.hpp"
+#include "llo/serialize.hpp"
+#include "llo/session.hpp"
+#include "llo/simplify.hpp"
+
+
+TEST(EVAL, SharedSubgraph)
+{
+	std::vector<ade::DimT> slist = {3, 2};
+	ade::Shape shape(slist);
+	size_t n = shape.n_elems();
+	std::vector<double> data = {
+		13, 98, 57, 4, 62, 31,
+	};
+	size_t depth = 48;
+
+	// without sharing, evaluating root would visit src 2^depth times
+	ade::TensptrT src = llo::get_variable<double>(data, shape);
+	ade::TensptrT root = src;
+	for (size_t i = 0; i < depth; ++i)
+	{
+		root = age::add(root, root);
+	}
+
+	llo::Evaluator evaler(age::DOUBLE);
+	root->accept(evaler);
+	EXPECT_EQ(depth + 1, evaler.results_.size());
+
+	llo::GenericData& out = evaler.out_;
+	ASSERT_EQ(age::DOUBLE, out.dtype_);
+	std::vector<ade::DimT> gotslist(out.shape_.begin(), out.shape_.end());
+	EXPECT_ARREQ(slist, gotslist);
+	double* optr = (double*) out.data_.get();
+	double scale = std::pow(2., depth);
+	for (size_t i = 0; i < n; ++i)
+	{
+		EXPECT_DOUBLE_EQ(data[i] * scale, optr[i]);
+	}
+}
+
+
+TEST(EVAL, PlanReplay)
+{
+	std::vector<ade::DimT> slist = {4, 3};
+	ade::Shape shape(slist);
+	size_t n = shape.n_elems();
+	std::vector<double> data = {
+		22, 15, 74, 38, 61, 95, 62, 81, 99, 76, 7, 22,
+	};
+	std::vector<double> data2 = {
+		56, 50, 19, 13, 12, 10, 31, 40, 60, 54, 6, 83,
+	};
+	std::vector<double> data3 = {
+		43, 28, 35, 9, 72, 17, 64, 25, 89, 3, 51, 46,
+	};
+
+	llo::VarptrT var = llo::get_variable<double>(data, shape);
+	ade::TensptrT src = var;
+	ade::TensptrT src2 = llo::get_variable<double>(data2, shape);
+	ade::TensptrT shared = age::sub(src, src2);
+	ade::TensptrT root = age::mul(age::add(shared, src2),
+		age::neg(age::reduce_sum(age::extend(shared, 2, {3}), 2)));
+
+	llo::Plan plan(root, age::DOUBLE);
+	ASSERT_EQ(8, plan.instrs_.size());
+
+	for (auto& input : {data, data3})
+	{
+		*var = input;
+		llo::GenericData expect = llo::eval(root, age::DOUBLE);
+		llo::GenericData got = plan.run();
+		ASSERT_EQ(age::DOUBLE, got.dtype_);
+		std::vector<ade::DimT> gotslist(got.shape_.begin(), got.shape_.end());
+		EXPECT_ARREQ(slist, gotslist);
+		double* eptr = (double*) expect.data_.get();
+		double* gptr = (double*) got.data_.get();
+		for (size_t i = 0; i < n; ++i)
+		{
+			EXPECT_DOUBLE_EQ(eptr[i], gptr[i]);
+		}
+	}
+}
+
+
+TEST(EVAL, PlanArena)
+{
+	std::vector<ade::DimT> slist = {4, 3};
+	ade::Shape shape(slist);
+	size_t n = shape.n_elems();
+	std::vector<double> data = {
+		22, 15, 74, 38, 61, 95, 62, 81, 99, 76, 7, 22,
+	};
+	size_t depth = 10;
+
+	ade::TensptrT src = llo::get_variable<double>(data, shape);
+	ade::TensptrT root = src;
+	for (size_t i = 0; i < depth; ++i)
+	{
+		root = age::add(age::neg(root), src);
+	}
+
+	llo::Plan plan(root, age::DOUBLE);
+	size_t nbytes = n * sizeof(double);
+	size_t total = (plan.slots_.size() - 1) * nbytes;
+	// src is alive throughout, and at most 2 other slots overlap
+	EXPECT_GT(total, plan.arena_size_);
+	EXPECT_GE(4 * nbytes, plan.arena_size_);
+	// slots start on their own cache lines
+	for (size_t i = 0, nslots = plan.slots_.size() - 1; i < nslots; ++i)
+	{
+		EXPECT_EQ(0, (uintptr_t) (plan.arena_.get() + plan.offsets_[i]) % 64);
+	}
+
+	llo::GenericData expect = llo::eval(root, age::DOUBLE);
+	for (size_t run = 0; run < 2; ++run)
+	{
+		llo::GenericData got = plan.run();
+		double* eptr = (double*) expect.data_.get();
+		double* gptr = (double*) got.data_.get();
+		for (size_t i = 0; i < n; ++i)
+		{
+			EXPECT_DOUBLE_EQ(eptr[i], gptr[i]);
+		}
+	}
+}
+
+
+TEST(EVAL, PlanParallel)
+{
+	std::vector<ade::DimT> slist = {4, 3};
+	ade::Shape shape(slist);
+	size_t n = shape.n_elems();
+	std::vector<double> data = {
+		22, 15, 74, 38, 61, 95, 62, 81, 99, 76, 7, 22,
+	};
+	std::vector<double> data2 = {
+		43, 28, 35, 9, 72, 17, 64, 25, 89, 3, 51, 46,
+	};
+	size_t nbranches = 8;
+	size_t depth = 6;
+
+	ade::TensptrT src = llo::get_variable<double>(data, shape);
+	ade::TensptrT src2 = llo::get_variable<double>(data2, shape);
+	// independent branches joined at root
+	ade::TensptrT root = src2;
+	for (size_t i = 0; i < nbranches; ++i)
+	{
+		ade::TensptrT branch = src;
+		for (size_t j = 0; j < depth; ++j)
+		{
+			branch = 0 == (i + j) % 2 ?
+				age::sub(age::neg(branch), src2) : age::add(branch, src);
+		}
+		root = age::add(root, branch);
+	}
+
+	llo::Plan plan(root, age::DOUBLE);
+	llo::GenericData expect = llo::eval(root, age::DOUBLE);
+	llo::ThreadPool pool(4);
+	ASSERT_EQ(4, pool.nthreads());
+	for (size_t run = 0; run < 3; ++run)
+	{
+		llo::GenericData got = plan.run(pool);
+		ASSERT_EQ(age::DOUBLE, got.dtype_);
+		double* eptr = (double*) expect.data_.get();
+		double* gptr = (double*) got.data_.get();
+		for (size_t i = 0; i < n; ++i)
+		{
+			EXPECT_DOUBLE_EQ(eptr[i], gptr[i]);
+		}
+	}
+
+	// runs on a pool never write to the plan, so they can overlap
+	std::vector<std::future<llo::GenericData>> runs;
+	for (size_t run = 0; run < 4; ++run)
+	{
+		runs.push_back(std::async(std::launch::async,
+			[&]() { return plan.run(pool); }));
+	}
+	for (std::future<llo::GenericData>& run : runs)
+	{
+		llo::GenericData got = run.get();
+		double* eptr = (double*) expect.data_.get();
+		double* gptr = (double*) got.data_.get();
+		for (size_t i = 0; i < n; ++i)
+		{
+			EXPECT_DOUBLE_EQ(eptr[i], gptr[i]);
+		}
+	}
+}
+
+
+TEST(EVAL, Fused)
+{
+	// span multiple fused blocks with a partial last block
+	std::vector<ade::DimT> slist = {250, 3};
+	ade::Shape shape(slist);
+	size_t n = shape.n_elems();
+	std::vector<double> data(n);
+	std::vector<double> data2(n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		data[i] = (i % 17) + 1;
+		data2[i] = (i % 5) * 0.5;
+	}
+
+	ade::TensptrT src = llo::get_variable<double>(data, shape);
+	ade::TensptrT src2 = llo::get_variable<double>(data2, shape);
+	// shared is read twice, so it ends a fused region
+	ade::TensptrT shared = age::mul(age::neg(src), src2);
+	ade::TensptrT flipped = age::flip(age::sqrt(src), 0);
+	ade::TensptrT root = age::add(
+		age::sub(age::exp(age::neg(src2)), shared),
+		age::div(age::mul(shared, flipped), src));
+
+	ade::TensptrT fused = llo::fuse(root);
+	auto froot = dynamic_cast<llo::FusedFunctor*>(fused.get());
+	ASSERT_NE(nullptr, froot);
+	// add, sub, exp, neg, div, mul
+	EXPECT_EQ(6, froot->get_steps().size());
+	EXPECT_EQ(4, froot->get_children().size());
+
+	llo::GenericData expect = llo::eval(root, age::DOUBLE);
+	llo::GenericData got = llo::eval(fused, age::DOUBLE);
+	llo::Plan plan(fused, age::DOUBLE);
+	llo::GenericData planned = plan.run();
+	double* eptr = (double*) expect.data_.get();
+	double* gptr = (double*) got.data_.get();
+	double* pptr = (double*) planned.data_.get();
+	for (size_t i = 0; i < n; ++i)
+	{
+		EXPECT_DOUBLE_EQ(eptr[i], gptr[i]);
+		EXPECT_DOUBLE_EQ(eptr[i], pptr[i]);
+	}
+}
+
+
+TEST(EVAL, OptimizeFused)
+{
+	std::vector<ade::DimT> slist = {4, 4};
+	ade::Shape shape(slist);
+	size_t n = shape.n_elems();
+	std::vector<double> data(n);
+	std::vector<double> data2(n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		data[i] = (i % 7) * 0.25;
+		data2[i] = (i % 3) + 0.5;
+	}
+
+	ade::TensptrT src = llo::get_variable<double>(data, shape);
+	ade::TensptrT src2 = llo::get_variable<double>(data2, shape);
+	// equal matmuls and the constant matmul read by the fused region
+	// are merged and folded after fusion
+	ade::TensptrT constant = age::matmul(
+		llo::get_scalar<double>(2, shape),
+		llo::get_scalar<double>(3, shape));
+	ade::TensptrT root = age::add(
+		age::mul(age::exp(age::matmul(src, src2)), constant),
+		age::neg(age::matmul(src, src2)));
+
+	ade::TensptrT fused = llo::fuse(root);
+	ASSERT_NE(nullptr, dynamic_cast<llo::FusedFunctor*>(fused.get()));
+	ade::TensptrT optimized = llo::simplify(llo::compose_maps(
+		llo::const_fold(llo::merge_common(fused))));
+	auto froot = dynamic_cast<llo::FusedFunctor*>(optimized.get());
+	ASSERT_NE(nullptr, froot);
+	EXPECT_NE(fused, optimized);
+	// add, mul, exp, neg
+	EXPECT_EQ(4, froot->get_steps().size());
+	const ade::ArgsT& children = froot->get_children();
+	ASSERT_EQ(3, children.size());
+	EXPECT_EQ(children[0].get_tensor(), children[2].get_tensor());
+	auto folded = dynamic_cast<llo::Variable*>(
+		children[1].get_tensor().get());
+	ASSERT_NE(nullptr, folded);
+	EXPECT_TRUE(folded->constant_);
+
+	llo::GenericData expect = llo::eval(root, age::DOUBLE);
+	llo::GenericData got = llo::eval(optimized, age::DOUBLE);
+	double* eptr = (double*) expect.data_.get();
+	double* gptr = (double*) got.data_.get();
+	for (size_t i = 0; i < n; ++i)
+	{
+		EXPECT_DOUBLE_EQ(eptr[i], gptr[i]);
+	}
+}
+
+
+TEST(EVAL, ConstFold)
+{
+	std::vector<ade::DimT> slist = {3, 2};
+	ade::Shape shape(slist);
+	size_t n = shape.n_elems();
+	std::vector<double> data = {
+		13, 98, 57, 4, 62, 31,
+	};
+
+	ade::TensptrT src = llo::get_variable<double>(data, shape);
+	ade::TensptrT constant = age::mul(
+		age::neg(llo::get_scalar<double>(1, shape)),
+		age::cos(llo::get_scalar<double>(2, shape)));
+	ade::TensptrT noise = age::rand_unif(
+		llo::get_scalar<double>(0, shape),
+		llo::get_scalar<double>(1, shape));
+	ade::TensptrT root = age::add(age::add(src, constant),
+		age::mul(noise, llo::get_scalar<double>(0, shape)));
+
+	ade::TensptrT folded = llo::const_fold(root);
+	auto froot = dynamic_cast<ade::iFunctor*>(folded.get());
+	ASSERT_NE(nullptr, froot);
+	auto left = dynamic_cast<ade::iFunctor*>(
+		froot->get_children()[0].get_tensor().get());
+	ASSERT_NE(nullptr, left);
+	EXPECT_EQ(src, left->get_children()[0].get_tensor());
+	// elementwise operations of scalars fold to a single value
+	auto cst = dynamic_cast<llo::Constant*>(
+		left->get_children()[1].get_tensor().get());
+	ASSERT_NE(nullptr, cst);
+	EXPECT_EQ(age::DOUBLE, cst->type_code());
+	EXPECT_DOUBLE_EQ(-std::cos(2), *((const double*) cst->value()));
+	EXPECT_TRUE(shape.compatible_after(cst->shape(), 0));
+	// random samples are never folded
+	auto right = dynamic_cast<ade::iFunctor*>(
+		froot->get_children()[1].get_tensor().get());
+	ASSERT_NE(nullptr, right);
+	EXPECT_NE(nullptr, dynamic_cast<ade::iFunctor*>(
+		right->get_children()[0].get_tensor().get()));
+
+	llo::GenericData expect = llo::eval(root, age::DOUBLE);
+	llo::GenericData got = llo::eval(folded, age::DOUBLE);
+	double* eptr = (double*) expect.data_.get();
+	double* gptr = (double*) got.data_.get();
+	for (size_t i = 0; i < n; ++i)
+	{
+		EXPECT_DOUBLE_EQ(eptr[i], gptr[i]);
+		EXPECT_DOUBLE_EQ(data[i] - std::cos(2), gptr[i]);
+	}
+}
+
+
+TEST(EVAL, ConstFoldScalar)
+{
+	// folding a large shape never materializes its elements
+	ade::Shape big({250, 250, 64});
+	ade::TensptrT src = llo::get_variable<double>(big, "src");
+	ade::TensptrT root = age::mul(src,
+		age::neg(age::exp(llo::get_scalar<double>(2, big))));
+	ade::TensptrT folded = llo::const_fold(root);
+	auto froot = dynamic_cast<ade::iFunctor*>(folded.get());
+	ASSERT_NE(nullptr, froot);
+	auto cst = dynamic_cast<llo::Constant*>(
+		froot->get_children()[1].get_tensor().get());
+	ASSERT_NE(nullptr, cst);
+	EXPECT_DOUBLE_EQ(-std::exp(2), *((const double*) cst->value()));
+	EXPECT_TRUE(big.compatible_after(cst->shape(), 0));
+
+	// values varying across elements are still materialized
+	std::vector<ade::DimT> slist = {3, 2};
+	ade::Shape shape(slist);
+	ade::TensptrT reduced = age::reduce_sum(
+		llo::get_scalar<double>(2, shape), 1);
+	ade::TensptrT varied = age::add(
+		llo::get_variable<double>(reduced->shape(), "dst"),
+		age::mul(reduced, age::exp(
+			llo::get_scalar<double>(1, reduced->shape()))));
+	ade::TensptrT vfolded = llo::const_fold(varied);
+	auto vroot = dynamic_cast<ade::iFunctor*>(vfolded.get());
+	ASSERT_NE(nullptr, vroot);
+	auto var = dynamic_cast<llo::Variable*>(
+		vroot->get_children()[1].get_tensor().get());
+	ASSERT_NE(nullptr, var);
+	EXPECT_TRUE(var->constant_);
+	llo::GenericData expect = llo::eval(varied, age::DOUBLE);
+	llo::GenericData got = llo::eval(vfolded, age::DOUBLE);
+	double* eptr = (double*) expect.data_.get();
+	double* gptr = (double*) got.data_.get();
+	for (size_t i = 0, n = reduced->shape().n_elems(); i < n; ++i)
+	{
+		EXPECT_DOUBLE_EQ(eptr[i], gptr[i]);
+	}
+}
+
+
+TEST(EVAL, Simplify)
+{
+	std::vector<ade::DimT> slist = {3, 2};
+	ade::Shape shape(slist);
+	size_t n = shape.n_elems();
+	std::vector<double> data = {
+		13, 98, 57, 4, 62, 31,
+	};
+
+	ade::TensptrT src = llo::get_variable<double>(data, shape);
+	ade::TensptrT one = llo::get_scalar<double>(1, shape);
+	// every layer simplifies away once its child is simplified
+	ade::TensptrT x = age::neg(age::neg(age::exp(age::log(src))));
+	x = age::pow(age::div(age::mul(one, x), one), one);
+	ade::TensptrT root = age::add(x, age::sub(src, src));
+
+	ade::TensptrT simple = llo::simplify(root);
+	auto sroot = dynamic_cast<ade::iFunctor*>(simple.get());
+	ASSERT_NE(nullptr, sroot);
+	EXPECT_EQ(age::SUM, sroot->get_opcode().code_);
+	EXPECT_EQ(src, sroot->get_children()[0].get_tensor());
+	EXPECT_TRUE(llo::is_constant_value(
+		sroot->get_children()[1].get_tensor().get(), 0));
+
+	llo::GenericData expect = llo::eval(root, age::DOUBLE);
+	llo::GenericData got = llo::eval(simple, age::DOUBLE);
+	double* eptr = (double*) expect.data_.get();
+	double* gptr = (double*) got.data_.get();
+	for (size_t i = 0; i < n; ++i)
+	{
+		EXPECT_DOUBLE_EQ(eptr[i], gptr[i]);
+	}
+}
+
+
+TEST(EVAL, ComposeMaps)
+{
+	std::vector<ade::DimT> slist = {3, 2};
+	std::vector<ade::DimT> slist2 = {2, 4, 3};
+	std::vector<ade::DimT> slist3 = {4, 3, 2};
+	ade::Shape shape(slist);
+	ade::Shape shape2(slist2);
+	ade::Shape shape3(slist3);
+	std::vector<double> data = {
+		13, 98, 57, 4, 62, 31,
+	};
+	std::vector<double> data2(shape2.n_elems());
+	std::vector<double> data3(shape3.n_elems());
+	for (size_t i = 0, n = data2.size(); i < n; ++i)
+	{
+		data2[i] = (i * 7) % 11;
+		data3[i] = (i * 5) % 13;
+	}
+
+	ade::TensptrT src = llo::get_variable<double>(data, shape);
+	ade::TensptrT src2 = llo::get_variable<double>(data2, shape2);
+	ade::TensptrT src3 = llo::get_variable<double>(data3, shape3);
+	// push over pull, push over push, and push over push over push
+	ade::TensptrT moved = age::permute(age::extend(src, 2, {4}), {2, 0, 1});
+	ade::TensptrT moved2 = age::flip(age::permute(src2, {1, 2, 0}), 1);
+	ade::TensptrT moved3 = age::transpose(age::transpose(src3));
+	ade::TensptrT root = age::add(age::sub(moved, moved2), moved3);
+	ade::TensptrT reduced = age::reduce_sum(age::permute(src3, {2, 0, 1}), 1);
+
+	ade::TensptrT composed = llo::compose_maps(root);
+	auto croot = dynamic_cast<ade::iFunctor*>(composed.get());
+	ASSERT_NE(nullptr, croot);
+	EXPECT_EQ(src3, croot->get_children()[1].get_tensor());
+	auto sub = dynamic_cast<ade::iFunctor*>(
+		croot->get_children()[0].get_tensor().get());
+	ASSERT_NE(nullptr, sub);
+	EXPECT_EQ(src, sub->get_children()[0].get_tensor());
+	EXPECT_EQ(src2, sub->get_children()[1].get_tensor());
+	ade::TensptrT composed_reduced = llo::compose_maps(reduced);
+	auto creduced = dynamic_cast<ade::iFunctor*>(composed_reduced.get());
+	ASSERT_NE(nullptr, creduced);
+	EXPECT_EQ(src3, creduced->get_children()[0].get_tensor());
+
+	for (auto pair : std::vector<std::pair<ade::TensptrT,ade::TensptrT>>{
+		{root, composed}, {reduced, composed_reduced}})
+	{
+		llo::GenericData expect = llo::eval(pair.first, age::DOUBLE);
+		llo::GenericData got = llo::eval(pair.second, age::DOUBLE);
+		ASSERT_TRUE(expect.shape_.compatible_after(got.shape_, 0));
+		double* eptr = (double*) expect.data_.get();
+		double* gptr = (double*) got.data_.get();
+		for (size_t i = 0, n = expect.shape_.n_elems(); i < n; ++i)
+		{
+			EXPECT_DOUBLE_EQ(eptr[i], gptr[i]);
+		}
+	}
+}
+
+
+TEST(EVAL, Constant)
+{
+	std::vector<ade::DimT> slist = {4, 3};
+	ade::Shape shape(slist);
+	size_t n = shape.n_elems();
+	std::vector<double> data = {
+		22, 15, 74, 38, 61, 95, 62, 81, 99, 76, 7, 22, 43, 28, 35, 9,
+	};
+
+	ade::TensptrT src = llo::get_variable<double>(
+		std::vector<double>(data.begin(), data.begin() + n), shape);
+	llo::ConstptrT cst = llo::get_scalar<double>(3, shape);
+	ade::TensptrT full = llo::get_variable<double>(
+		std::vector<double>(n, 3), shape);
+	ade::TensptrT sq = llo::get_variable<double>(
+		std::vector<double>(data.begin(), data.begin() + 16),
+		ade::Shape({4, 4}));
+	// broadcast elementwise, accumulated by reduction, and ignored mappings
+	auto build = [&](ade::TensptrT c)
+	{
+		return age::add(age::mul(src, c), age::add(
+			age::extend(age::reduce_sum(c, 1), 1, {3}),
+			llo::matmul(c, sq)));
+	};
+	ade::TensptrT root = build(cst);
+	ade::TensptrT expect_root = build(full);
+
+	llo::GenericData expect = llo::eval(expect_root, age::DOUBLE);
+	llo::GenericData got = llo::eval(root, age::DOUBLE);
+	llo::Plan plan(root, age::DOUBLE);
+	llo::GenericData planned = plan.run();
+	llo::ThreadPool pool(2);
+	llo::GenericData parallel = plan.run(pool);
+	double* eptr = (double*) expect.data_.get();
+	double* gptr = (double*) got.data_.get();
+	double* pptr = (double*) planned.data_.get();
+	double* parptr = (double*) parallel.data_.get();
+	for (size_t i = 0; i < n; ++i)
+	{
+		EXPECT_DOUBLE_EQ(eptr[i], gptr[i]);
+		EXPECT_DOUBLE_EQ(eptr[i], pptr[i]);
+		EXPECT_DOUBLE_EQ(eptr[i], parptr[i]);
+	}
+
+	// constants expand to their full shape when read directly
+	llo::GenericData cdata = llo::eval(cst, age::INT32);
+	ASSERT_TRUE(shape.compatible_after(cdata.shape_, 0));
+	const double* raw = (const double*) cst->data();
+	int32_t* cptr = (int32_t*) cdata.data_.get();
+	for (size_t i = 0; i < n; ++i)
+	{
+		EXPECT_EQ(3, cptr[i]);
+		EXPECT_DOUBLE_EQ(3, raw[i]);
+	}
+}
+
+
+TEST(EVAL, ConstantValue)
+{
+	ade::Shape shape({3, 2});
+	llo::VarptrT zeros = llo::get_variable<int32_t>(
+		std::vector<int32_t>{0, 0, 0, 0, 0, 0}, shape);
+	llo::VarptrT mixed = llo::get_variable<int32_t>(
+		std::vector<int32_t>{0, 0, 0, 0, 0, 1}, shape);
+	llo::VarptrT halves = llo::get_variable<float>(
+		std::vector<float>{0.5, 0.5, 0.5, 0.5, 0.5, 0.5}, shape);
+
+	// only constant data is compared
+	EXPECT_FALSE(llo::is_constant_value(zeros.get(), 0));
+	zeros->constant_ = true;
+	mixed->constant_ = true;
+	halves->constant_ = true;
+
+	// elements are compared in their own type
+	EXPECT_TRUE(llo::is_constant_value(zeros.get(), 0));
+	EXPECT_FALSE(llo::is_constant_value(zeros.get(), 0.5));
+	EXPECT_FALSE(llo::is_constant_value(mixed.get(), 0));
+	EXPECT_TRUE(llo::is_constant_value(halves.get(), 0.5));
+	EXPECT_FALSE(llo::is_constant_value(halves.get(), 0));
+
+	llo::ConstptrT two = llo::get_scalar<uint8_t>(2, shape);
+	EXPECT_TRUE(llo::is_constant_value(two.get(), 2));
+	EXPECT_FALSE(llo::is_constant_value(two.get(), 0));
+}
+
+
+TEST(EVAL, Session)
+{
+	std::vector<ade::DimT> slist = {3, 2};
+	ade::Shape shape(slist);
+	std::vector<double> data = {1, 2, 3, 4, 5, 6};
+	std::vector<double> data2 = {7, 8, 9, 10, 11, 12};
+	std::vector<double> cdata = {2, 1, 4, 3, 6, 5};
+
+	llo::VarptrT var = llo::get_variable<double>(data, shape);
+	ade::TensptrT cst = llo::get_variable<double>(cdata, shape);
+	ade::TensptrT unchanged = age::exp(cst);
+	ade::TensptrT root = age::add(age::mul(var, unchanged), var);
+
+	llo::Session session(root, age::DOUBLE);
+	llo::GenericData first = session.run();
+	double* fptr = (double*) first.data_.get();
+	for (size_t i = 0, n = shape.n_elems(); i < n; ++i)
+	{
+		EXPECT_DOUBLE_EQ(data[i] * std::exp(cdata[i]) + data[i], fptr[i]);
+	}
+	llo::GenericData cached = session.get_result(unchanged.get());
+	ASSERT_NE(nullptr, cached.data_);
+
+	*var = data2;
+	llo::GenericData second = session.run();
+	double* sptr = (double*) second.data_.get();
+	for (size_t i = 0, n = shape.n_elems(); i < n; ++i)
+	{
+		EXPECT_DOUBLE_EQ(data2[i] * std::exp(cdata[i]) + data2[i], sptr[i]);
+	}
+	// only nodes downstream of var are recomputed
+	EXPECT_NE(first.data_.get(), second.data_.get());
+	EXPECT_EQ(cached.data_.get(),
+		session.get_result(unchanged.get()).data_.get());
+
+	// rerunning without assignment reuses the root's result
+	llo::GenericData third = session.run();
+	EXPECT_EQ(second.data_.get(), third.data_.get());
+}
+
+
+TEST(EVAL, LazySession)
+{
+	std::vector<ade::DimT> slist = {3, 2};
+	ade::Shape shape(slist);
+	size_t n = shape.n_elems();
+	std::vector<double> data = {1, 2, 3, 4, 5, 6};
+	std::vector<double> data2 = {7, 8, 9, 10, 11, 12};
+
+	size_t nfetches = 0;
+	ade::TensptrT lazy = llo::lazy_deserialize(
+		[&]()
+		{
+			++nfetches;
+			return llo::serialize((const char*) &data[0], n, age::DOUBLE);
+		}, shape, age::DOUBLE, "lazy", pbm::LeafInfo());
+	ade::TensptrT root = age::exp(lazy);
+
+	llo::Session session(root, age::DOUBLE);
+	llo::GenericData first = session.run();
+	double* fptr = (double*) first.data_.get();
+	for (size_t i = 0; i < n; ++i)
+	{
+		EXPECT_DOUBLE_EQ(std::exp(data[i]), fptr[i]);
+	}
+	EXPECT_EQ(1, nfetches);
+
+	// loaded leaves are unchanged until their variable is assigned
+	llo::GenericData second = session.run();
+	EXPECT_EQ(first.data_.get(), second.data_.get());
+
+	auto lvar = dynamic_cast<llo::LazyVariable*>(lazy.get());
+	ASSERT_NE(nullptr, lvar);
+	*(lvar->get_var()) = data2;
+	llo::GenericData third = session.run();
+	EXPECT_NE(second.data_.get(), third.data_.get());
+	double* tptr = (double*) third.data_.get();
+	for (size_t i = 0; i < n; ++i)
+	{
+		EXPECT_DOUBLE_EQ(std::exp(data2[i]), tptr[i]);
+	}
+	EXPECT_EQ(1, nfetches);
+}
+
+
+TEST(EVAL, BorrowVariable)
+{
+	std::vector<ade::DimT> slist = {3, 2};
+	ade::Shape shape(slist);
+	std::vector<double> data = {1, 2, 3, 4, 5, 6};
+	std::vector<double> data2 = {7, 8, 9, 10, 11, 12};
+
+	llo::VarptrT var = llo::get_variable<double>(data, shape);
+	llo::Evaluator evaler(age::DOUBLE);
+	var->accept(evaler);
+	llo::GenericData borrowed = evaler.out_;
+	EXPECT_EQ(var->data(), borrowed.data_.get());
+
+	// assignment leaves borrowed data unchanged
+	*var = data2;
+	EXPECT_NE(var->data(), borrowed.data_.get());
+	double* bptr = (double*) borrowed.data_.get();
+	double* vptr = (double*) var->data();
+	for (size_t i = 0, n = shape.n_elems(); i < n; ++i)
+	{
+		EXPECT_DOUBLE_EQ(data[i], bptr[i]);
+		EXPECT_DOUBLE_EQ(data2[i], vptr[i]);
+	}
+
+	// other types are converted
+	llo::GenericData converted = llo::eval(var, age::INT32);
+	int32_t* cptr = (int32_t*) converted.data_.get();
+	for (size_t i = 0, n = shape.n_elems(); i < n; ++i)
+	{
+		EXPECT_EQ((int32_t) data2[i], cptr[i]);
+	}
+}
+
+
+TEST(EVAL, MergeRandom)
+{
+	ade::Shape shape({3, 2});
+	ade::TensptrT a = llo::get_variable<double>(shape, "a");
+	ade::TensptrT b = llo::get_variable<double>(
+		std::vector<double>(shape.n_elems(), 1), shape, "b");
+	ade::TensptrT root = age::add(age::add(
+		age::rand_unif(a, b), age::rand_unif(a, b)),
+		age::add(age::exp(a), age::exp(a)));
+
+	ade::TensptrT merged = llo::merge_common(root);
+	auto mfunc = static_cast<ade::iFunctor*>(merged.get());
+	auto samples = static_cast<ade::iFunctor*>(
+		mfunc->get_children()[0].get_tensor().get());
+	auto exps = static_cast<ade::iFunctor*>(
+		mfunc->get_children()[1].get_tensor().get());
+	// independent samples stay separate while deterministic nodes merge
+	EXPECT_NE(samples->get_children()[0].get_tensor(),
+		samples->get_children()[1].get_tensor());
+	EXPECT_EQ(exps->get_children()[0].get_tensor(),
+		exps->get_children()[1].get_tensor());
+}
+
+
+
+TEST(EVAL, MergeConstants)
+{
+	ade::Shape shape({3, 2});
+	std::vector<double> data = {1, 2, 3, 4, 5, 6};
+	llo::VarptrT a = llo::get_variable<double>(data, shape, "a");
+	llo::VarptrT a2 = llo::get_variable<double>(data, shape, "a2");
+	llo::VarptrT b = llo::get_variable<double>(
+		std::vector<double>{6, 5, 4, 3, 2, 1}, shape, "b");
+	a->constant_ = true;
+	a2->constant_ = true;
+	b->constant_ = true;
+
+	// keys hash data instead of holding it
+	std::string key = llo::constant_key(a.get());
+	EXPECT_GT(a->nbytes(), key.size());
+	EXPECT_STREQ(key.c_str(), llo::constant_key(a2.get()).c_str());
+	EXPECT_TRUE(llo::equal_constants(a.get(), a2.get()));
+	EXPECT_FALSE(llo::equal_constants(a.get(), b.get()));
+
+	ade::TensptrT root = age::add(age::add(a, a2), b);
+	ade::TensptrT merged = llo::merge_common(root);
+	auto mfunc = static_cast<ade::iFunctor*>(merged.get());
+	auto sum = static_cast<ade::iFunctor*>(
+		mfunc->get_children()[0].get_tensor().get());
+	EXPECT_EQ(sum->get_children()[0].get_tensor(),
+		sum->get_children()[1].get_tensor());
+	EXPECT_NE(sum->get_children()[0].get_tensor(),
+		mfunc->get_children()[1].get_tensor());
+}
+
+
+#endif // DISABLE_EVAL_TEST
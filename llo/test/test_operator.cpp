@@ -2,6 +2,10 @@
 #ifndef DISABLE_OPERATOR_TEST
 
 
+#include <chrono>
+#include <mutex>
+#include <thread>
+
 #include "gtest/gtest.h"
 
 #include "llo/test/common.hpp"
@@ -262,4 +266,491 @@ TEST(OPERATOR, Nnary)
 }
 
 
+// restore parallel configuration even if a test returns early
+struct ConfigGuard final
+{
+    ConfigGuard (void) : original_(llo::get_parallel_config()) {}
+
+    ~ConfigGuard (void)
+    {
+        llo::get_parallel_config() = original_;
+    }
+
+    llo::ParallelConfig original_;
+};
+
+
+TEST(OPERATOR, Parallel)
+{
+    ConfigGuard guard;
+    llo::ParallelConfig& config = llo::get_parallel_config();
+    // force small inputs to be split into chunks
+    config.threshold_ = 1;
+    config.grain_ = 3;
+
+    std::vector<size_t> counts(100, 0);
+    llo::parallel_for(counts.size(),
+        [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                ++counts[i];
+            }
+        });
+    std::vector<size_t> expect_counts(counts.size(), 1);
+    EXPECT_ARREQ(expect_counts, counts);
+
+    ade::Shape shape({4, 3});
+    std::vector<double> data = {
+        34,73,1,67,
+        91,91,7,6,
+        86,86,85,83,
+    };
+    std::vector<double> data2 = {
+        75,22,33,86,
+        18,99,68,37,
+        86,80,47,73,
+    };
+    llo::VecRef<double> ref{&data[0], shape, ade::identity, false};
+    llo::VecRef<double> ref2{&data2[0], shape, ade::identity, false};
+    std::vector<double> out(12);
+    std::vector<double> expect_out(12);
+
+    llo::unary<double>(&out[0], shape, ref,
+        [](const double& in) { return -in; });
+    for (size_t i = 0; i < 12; ++i)
+    {
+        expect_out[i] = -data[i];
+    }
+    EXPECT_ARREQ(expect_out, out);
+
+    llo::binary<double,double,double>(&out[0], shape, ref, ref2,
+        [](const double& a, const double& b) { return a - b; });
+    for (size_t i = 0; i < 12; ++i)
+    {
+        expect_out[i] = data[i] - data2[i];
+    }
+    EXPECT_ARREQ(expect_out, out);
+
+    llo::nnary<double>(&out[0], shape, {ref, ref2, ref},
+        [](double& acc, const double& in) { acc *= in; });
+    for (size_t i = 0; i < 12; ++i)
+    {
+        expect_out[i] = data[i] * data2[i] * data[i];
+    }
+    EXPECT_ARREQ(expect_out, out);
+}
+
+
+TEST(OPERATOR, ParallelCost)
+{
+    ConfigGuard guard;
+    llo::ParallelConfig& config = llo::get_parallel_config();
+    config.threshold_ = 1 << 10;
+    config.grain_ = 1 << 8;
+
+    std::mutex mtx;
+    std::vector<std::pair<size_t,size_t>> chunks;
+    auto record = [&](size_t begin, size_t end)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        chunks.push_back({begin, end});
+    };
+
+    // few indices of little work run in one chunk
+    llo::parallel_for(8, 1, record);
+    ASSERT_EQ(1, chunks.size());
+    EXPECT_EQ(0, chunks[0].first);
+    EXPECT_EQ(8, chunks[0].second);
+
+    // few indices of much work are split when workers are available
+    chunks.clear();
+    llo::parallel_for(8, 1 << 10, record);
+    if (llo::get_pool().nthreads() > 0)
+    {
+        EXPECT_LT(1, chunks.size());
+    }
+    std::vector<size_t> counts(8, 0);
+    for (auto& chunk : chunks)
+    {
+        for (size_t i = chunk.first; i < chunk.second; ++i)
+        {
+            ++counts[i];
+        }
+    }
+    std::vector<size_t> expect_counts(8, 1);
+    EXPECT_ARREQ(expect_counts, counts);
+}
+
+
+TEST(OPERATOR, ParallelReduce)
+{
+    ConfigGuard guard;
+    llo::ParallelConfig& config = llo::get_parallel_config();
+    // force small reductions to be split into partial outputs
+    config.threshold_ = 1;
+    config.grain_ = 8;
+
+    size_t ncols = 4;
+    size_t nrows = 64;
+    ade::Shape shape({(ade::DimT) ncols, (ade::DimT) nrows});
+    ade::Shape reduced_shape({(ade::DimT) ncols});
+    std::vector<double> data(shape.n_elems());
+    for (size_t i = 0, n = data.size(); i < n; ++i)
+    {
+        data[i] = (i * 7) % 13;
+    }
+    std::vector<double> base = {3, 1, 4, 1};
+
+    ade::CoordptrT reduce_mapper(
+        new ade::CoordMap([](ade::MatrixT m)
+        {
+            for (uint8_t i = 0; i < ade::mat_dim; ++i)
+            {
+                m[i][i] = 1;
+            }
+            m[1][1] = 0;
+        }));
+
+    std::vector<double> expect_out = base;
+    for (size_t i = 0, n = data.size(); i < n; ++i)
+    {
+        expect_out[i % ncols] += data[i];
+    }
+
+    // push after an argument already visited every output
+    llo::VecRef<double> baseref{&base[0], reduced_shape, ade::identity, false};
+    llo::VecRef<double> inref{&data[0], shape, reduce_mapper, true};
+    std::vector<double> out(ncols);
+    llo::nnary<double>(&out[0], reduced_shape, {baseref, inref},
+        [](double& acc, const double& in) { acc += in; });
+    EXPECT_ARREQ(expect_out, out);
+
+    // push first, so partial outputs set unvisited outputs
+    llo::nnary<double>(&out[0], reduced_shape, {inref, baseref},
+        [](double& acc, const double& in) { acc += in; });
+    EXPECT_ARREQ(expect_out, out);
+}
+
+
+TEST(OPERATOR, PoolWait)
+{
+    llo::ThreadPool pool(2);
+    std::atomic<size_t> nremaining(8);
+    std::atomic<size_t> nran(0);
+    // tasks outlast the caller's pending work, so it waits asleep
+    // and is woken by the last count down, including nested tasks
+    std::function<void(size_t)> task = [&](size_t depth)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        if (depth > 0)
+        {
+            pool.submit([&task, depth]() { task(depth - 1); });
+        }
+        ++nran;
+        pool.count_down(nremaining);
+    };
+    for (size_t i = 0; i < 4; ++i)
+    {
+        pool.submit([&task]() { task(1); });
+    }
+    pool.wait(nremaining);
+    EXPECT_EQ(0, nremaining);
+    EXPECT_EQ(8, nran);
+}
+
+
+TEST(OPERATOR, Stride)
+{
+    ade::Shape inshape({3, 4, 2});
+    ade::Shape outshape({4, 2, 1});
+    // swap first two dimensions, and reduce the third
+    ade::CoordptrT mapper(
+        new ade::CoordMap([](ade::MatrixT m)
+        {
+            for (uint8_t i = 3; i < ade::mat_dim; ++i)
+            {
+                m[i][i] = 1;
+            }
+            m[0][1] = 1;
+            m[1][0] = 1;
+            m[2][2] = 0.5;
+        }));
+
+    llo::StrideIndexer indexer(*mapper, inshape, outshape);
+    ASSERT_TRUE(indexer.valid_);
+    std::vector<ade::NElemT> expect_idx;
+    std::vector<ade::NElemT> got_idx;
+    ade::CoordT coord;
+    for (ade::NElemT i = 0, n = inshape.n_elems(); i < n; ++i)
+    {
+        mapper->forward(coord.begin(), ade::coordinate(inshape, i).begin());
+        expect_idx.push_back(ade::index(outshape, coord));
+    }
+    // walk in two pieces to check walks starting mid-dimension
+    for (auto range : {std::pair<size_t,size_t>{0, 7},
+        std::pair<size_t,size_t>{7, inshape.n_elems()}})
+    {
+        llo::stride_walk<1>(inshape, range.first, range.second, {&indexer},
+            [&](ade::NElemT i, const std::array<ade::NElemT,1>& mapped)
+            {
+                EXPECT_EQ(got_idx.size(), i);
+                got_idx.push_back(mapped[0]);
+            });
+    }
+    EXPECT_ARREQ(expect_idx, got_idx);
+
+    // output dimension 0 depends on 2 input dimensions
+    ade::CoordptrT skew(
+        new ade::CoordMap([](ade::MatrixT m)
+        {
+            for (uint8_t i = 0; i < ade::mat_dim; ++i)
+            {
+                m[i][i] = 1;
+            }
+            m[1][0] = 1;
+        }));
+    llo::StrideIndexer skew_indexer(*skew, inshape, inshape);
+    EXPECT_FALSE(skew_indexer.valid_);
+}
+
+
+TEST(OPERATOR, Contiguous)
+{
+    ade::Shape shape({4, 3});
+    std::vector<float> data = {
+        0.34,0.73,0.1,0.67,
+        0.91,0.91,0.7,0.6,
+        0.86,0.86,0.85,0.83,
+    };
+    std::vector<int32_t> idata = {
+        34,-73,1,67,
+        91,91,-7,6,
+        86,86,-85,83,
+    };
+    std::vector<int32_t> idata2 = {
+        75,22,-33,86,
+        18,99,68,37,
+        86,-80,47,73,
+    };
+
+    std::vector<float> out(12);
+    llo::exp<float>(&out[0], llo::VecRef<float>{
+        &data[0], shape, ade::identity, false});
+    for (size_t i = 0; i < 12; ++i)
+    {
+        EXPECT_FLOAT_EQ(std::exp(data[i]), out[i]);
+    }
+
+    std::vector<int32_t> iout(12);
+    llo::VecRef<int32_t> iref{&idata[0], shape, ade::identity, false};
+    llo::VecRef<int32_t> iref2{&idata2[0], shape, ade::identity, false};
+    llo::max<int32_t>(&iout[0], shape, {iref, iref2, iref});
+    for (size_t i = 0; i < 12; ++i)
+    {
+        EXPECT_EQ(std::max(idata[i], idata2[i]), iout[i]);
+    }
+
+    llo::lt<int32_t>(&iout[0], shape, iref, iref2);
+    for (size_t i = 0; i < 12; ++i)
+    {
+        EXPECT_EQ(idata[i] < idata2[i], iout[i]);
+    }
+}
+
+
+template <typename T>
+static void check_vector_math (void)
+{
+    // odd length covers vector iterations and the remaining tail
+    size_t n = 1027;
+    std::vector<T> in(n);
+    std::vector<T> in2(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        in[i] = 0.01 + 20 * (T) i / n;
+        in2[i] = -2 + 4 * (T) i / n;
+    }
+    std::vector<T> out(n);
+    llo::contiguous_unary(&out[0], &in[0], n, llo::ExpOp());
+    for (size_t i = 0; i < n; ++i)
+    {
+        EXPECT_FLOAT_EQ(std::exp(in[i]), out[i]);
+    }
+    llo::contiguous_unary(&out[0], &in[0], n, llo::LogOp());
+    for (size_t i = 0; i < n; ++i)
+    {
+        EXPECT_FLOAT_EQ(std::log(in[i]), out[i]);
+    }
+    llo::contiguous_unary(&out[0], &in[0], n, llo::SinOp());
+    for (size_t i = 0; i < n; ++i)
+    {
+        EXPECT_NEAR(std::sin(in[i]), out[i], 1e-6);
+    }
+    llo::contiguous_unary(&out[0], &in[0], n, llo::CosOp());
+    for (size_t i = 0; i < n; ++i)
+    {
+        EXPECT_NEAR(std::cos(in[i]), out[i], 1e-6);
+    }
+    llo::contiguous_binary(&out[0], &in[0], &in2[0], n, llo::PowOp());
+    for (size_t i = 0; i < n; ++i)
+    {
+        EXPECT_FLOAT_EQ(std::pow(in[i], in2[i]), out[i]);
+    }
+}
+
+
+TEST(OPERATOR, VectorMath)
+{
+    check_vector_math<float>();
+    check_vector_math<double>();
+}
+
+
+TEST(OPERATOR, Gemm)
+{
+    // rows don't divide evenly into tiles
+    size_t ncommon = 250;
+    size_t nrows = 7;
+    size_t ncols = 5;
+    ade::Shape ashape({(ade::DimT) ncommon, (ade::DimT) nrows});
+    ade::Shape bshape({(ade::DimT) ncols, (ade::DimT) ncommon});
+    ade::Shape outshape({(ade::DimT) ncols, (ade::DimT) nrows});
+    std::vector<int32_t> a(ashape.n_elems());
+    std::vector<int32_t> b(bshape.n_elems());
+    for (size_t i = 0, n = a.size(); i < n; ++i)
+    {
+        a[i] = (i * 7) % 13 - 6;
+    }
+    for (size_t i = 0, n = b.size(); i < n; ++i)
+    {
+        b[i] = (i * 5) % 11 - 5;
+    }
+
+    std::vector<int32_t> expect_out(outshape.n_elems(), 0);
+    for (size_t i = 0; i < nrows; ++i)
+    {
+        for (size_t j = 0; j < ncols; ++j)
+        {
+            for (size_t k = 0; k < ncommon; ++k)
+            {
+                expect_out[i * ncols + j] +=
+                    a[i * ncommon + k] * b[k * ncols + j];
+            }
+        }
+    }
+
+    std::vector<int32_t> out(outshape.n_elems());
+    llo::gemm<int32_t>(&out[0],
+        llo::VecRef<int32_t>{&a[0], ashape, ade::identity, false},
+        llo::VecRef<int32_t>{&b[0], bshape, ade::identity, false});
+    EXPECT_ARREQ(expect_out, out);
+}
+
+
+
+TEST(OPERATOR, Conv2d)
+{
+    ConfigGuard guard;
+    llo::ParallelConfig& config = llo::get_parallel_config();
+    // force small inputs to be split into chunks
+    config.threshold_ = 1;
+    config.grain_ = 1;
+
+    // even kernel sizes, multiple output channels and batches
+    size_t nchannels = 2;
+    size_t in_height = 5;
+    size_t in_width = 4;
+    size_t nbatch = 2;
+    size_t nfilters = 3;
+    size_t kheight = 2;
+    size_t kwidth = 2;
+    size_t out_height = in_height - kheight + 1;
+    size_t out_width = in_width - kwidth + 1;
+    ade::Shape imgshape({(ade::DimT) nchannels, (ade::DimT) in_height,
+        (ade::DimT) in_width, (ade::DimT) nbatch});
+    ade::Shape kernshape({(ade::DimT) nfilters, (ade::DimT) nchannels,
+        (ade::DimT) kheight, (ade::DimT) kwidth});
+    ade::Shape outshape({(ade::DimT) nfilters, (ade::DimT) out_height,
+        (ade::DimT) out_width, (ade::DimT) nbatch});
+
+    std::vector<int32_t> img(imgshape.n_elems());
+    std::vector<int32_t> kernel(kernshape.n_elems());
+    std::vector<int32_t> grad(outshape.n_elems());
+    for (size_t i = 0, n = img.size(); i < n; ++i)
+    {
+        img[i] = (i * 7) % 13 - 6;
+    }
+    for (size_t i = 0, n = kernel.size(); i < n; ++i)
+    {
+        kernel[i] = (i * 5) % 11 - 5;
+    }
+    for (size_t i = 0, n = grad.size(); i < n; ++i)
+    {
+        grad[i] = (i * 3) % 7 - 3;
+    }
+    auto img_at = [&](size_t c, size_t y, size_t x, size_t b)
+    {
+        return c + nchannels * (y + in_height * (x + in_width * b));
+    };
+    auto kern_at = [&](size_t o, size_t c, size_t ky, size_t kx)
+    {
+        return o + nfilters * (c + nchannels * (ky + kheight * kx));
+    };
+    auto out_at = [&](size_t o, size_t y, size_t x, size_t b)
+    {
+        return o + nfilters * (y + out_height * (x + out_width * b));
+    };
+
+    std::vector<int32_t> expect_out(outshape.n_elems(), 0);
+    std::vector<int32_t> expect_imggrad(imgshape.n_elems(), 0);
+    std::vector<int32_t> expect_kerngrad(kernshape.n_elems(), 0);
+    for (size_t b = 0; b < nbatch; ++b)
+    {
+        for (size_t x = 0; x < out_width; ++x)
+        {
+            for (size_t y = 0; y < out_height; ++y)
+            {
+                for (size_t o = 0; o < nfilters; ++o)
+                {
+                    for (size_t kx = 0; kx < kwidth; ++kx)
+                    {
+                        for (size_t ky = 0; ky < kheight; ++ky)
+                        {
+                            for (size_t c = 0; c < nchannels; ++c)
+                            {
+                                size_t ii = img_at(c, y + ky, x + kx, b);
+                                size_t ki = kern_at(o, c, ky, kx);
+                                size_t oi = out_at(o, y, x, b);
+                                expect_out[oi] += img[ii] * kernel[ki];
+                                expect_imggrad[ii] += grad[oi] * kernel[ki];
+                                expect_kerngrad[ki] += grad[oi] * img[ii];
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector<int32_t> out(outshape.n_elems());
+    llo::conv2d<int32_t>(&out[0], outshape,
+        llo::VecRef<int32_t>{&img[0], imgshape, ade::identity, false},
+        llo::VecRef<int32_t>{&kernel[0], kernshape, ade::identity, false});
+    EXPECT_ARREQ(expect_out, out);
+
+    std::vector<int32_t> imggrad(imgshape.n_elems());
+    llo::conv2d_image_grad<int32_t>(&imggrad[0], imgshape,
+        llo::VecRef<int32_t>{&grad[0], outshape, ade::identity, false},
+        llo::VecRef<int32_t>{&kernel[0], kernshape, ade::identity, false});
+    EXPECT_ARREQ(expect_imggrad, imggrad);
+
+    std::vector<int32_t> kerngrad(kernshape.n_elems());
+    llo::conv2d_kernel_grad<int32_t>(&kerngrad[0], kernshape,
+        llo::VecRef<int32_t>{&img[0], imgshape, ade::identity, false},
+        llo::VecRef<int32_t>{&grad[0], outshape, ade::identity, false});
+    EXPECT_ARREQ(expect_kerngrad, kerngrad);
+}
+
+
 #endif // DISABLE_OPERATOR_TEST
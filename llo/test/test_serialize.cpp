@@ -0,0 +1,281 @@
+
+#ifndef DISABLE_SERIALIZE_TEST
+
+
+#include <fstream>
+
+#include "gtest/gtest.h"
+
+#include "llo/test/common.hpp"
+
+#include "llo/generated/api.hpp"
+
+#include "llo/cse.hpp"
+#include "llo/eval.hpp"
+#include "llo/fold.hpp"
+#include "llo/mmap.hpp"
+#include "llo/serialize.hpp"
+#include "llo/zprune.hpp"
+
+#include "pbm/load.hpp"
+#include "pbm/save.hpp"
+
+
+TEST(SERIALIZE, ConstantRoundTrip)
+{
+	ade::Shape shape({3, 2});
+	llo::VarptrT x = llo::get_variable<double>(
+		std::vector<double>{1, 2, 3, 4, 5, 6}, shape, "x");
+	llo::VarptrT zero = llo::get_variable<double>(shape, "zero");
+	zero->constant_ = true;
+	ade::TensptrT root = age::mul(x, zero);
+
+	pbm::GraphSaver saver(llo::serialize, llo::leaf_info);
+	root->accept(saver);
+	cortenn::Graph graph;
+	saver.save(graph, pbm::PathedMapT{
+		{x, {"x"}},
+		{zero, {"zero"}},
+		{root, {"root"}},
+	});
+
+	pbm::GraphInfo info;
+	pbm::load_graph(info, graph, llo::deserialize);
+	ade::TensptrT gotx = info.tens_.get_labelled({"x"});
+	ade::TensptrT gotzero = info.tens_.get_labelled({"zero"});
+	ade::TensptrT gotroot = info.tens_.get_labelled({"root"});
+	ASSERT_NE(nullptr, gotx);
+	ASSERT_NE(nullptr, gotzero);
+	ASSERT_NE(nullptr, gotroot);
+	EXPECT_FALSE(llo::is_constant(
+		static_cast<ade::iLeaf*>(gotx.get())));
+	EXPECT_TRUE(llo::is_constant(
+		static_cast<ade::iLeaf*>(gotzero.get())));
+
+	// gradient through the loaded zero is still pruned to a zero leaf
+	ade::TensptrT grad = llo::derive(gotroot, gotx.get());
+	EXPECT_TRUE(llo::is_constant_value(grad.get(), 0));
+}
+
+
+
+TEST(SERIALIZE, ScalarRoundTrip)
+{
+	ade::Shape shape({3, 2});
+	llo::VarptrT x = llo::get_variable<double>(
+		std::vector<double>{1, 2, 3, 4, 5, 6}, shape, "x");
+	llo::ConstptrT three = llo::get_scalar<double>(3, shape);
+	ade::TensptrT root = age::add(x, three);
+
+	pbm::GraphSaver saver(llo::serialize, llo::leaf_info);
+	root->accept(saver);
+	cortenn::Graph graph;
+	saver.save(graph, pbm::PathedMapT{
+		{three, {"three"}},
+		{root, {"root"}},
+	});
+	// shuffled single values are grouped as one element
+	pbm::GraphSaver shuffler(llo::serialize, llo::leaf_info, pbm::RAW_CODEC, true);
+	root->accept(shuffler);
+	cortenn::Graph shuffled;
+	shuffler.save(shuffled, pbm::PathedMapT{
+		{three, {"three"}},
+		{root, {"root"}},
+	});
+	std::stringstream stream;
+	saver.save(stream, pbm::PathedMapT{
+		{three, {"three"}},
+		{root, {"root"}},
+	});
+	for (const cortenn::Node& node : graph.nodes())
+	{
+		if (node.has_source() && node.source().scalar())
+		{
+			// only the single value is saved
+			EXPECT_EQ(sizeof(double), node.source().data().size());
+		}
+	}
+
+	pbm::GraphInfo info;
+	pbm::load_graph(info, graph, llo::deserialize);
+	pbm::GraphInfo streaminfo;
+	pbm::load_graph(streaminfo, stream, llo::deserialize);
+	pbm::GraphInfo shuffledinfo;
+	pbm::load_graph(shuffledinfo, shuffled, llo::deserialize);
+	for (pbm::GraphInfo* loaded : {&info, &streaminfo, &shuffledinfo})
+	{
+		auto cst = dynamic_cast<llo::Constant*>(
+			loaded->tens_.get_labelled({"three"}).get());
+		ASSERT_NE(nullptr, cst);
+		EXPECT_EQ(age::DOUBLE, cst->type_code());
+		EXPECT_STREQ(shape.to_string().c_str(),
+			cst->shape().to_string().c_str());
+		EXPECT_EQ(3, *((const double*) cst->value()));
+
+		llo::GenericData out = llo::eval(
+			loaded->tens_.get_labelled({"root"}), age::DOUBLE);
+		double* ptr = (double*) out.data_.get();
+		std::vector<double> got(ptr, ptr + out.shape_.n_elems());
+		std::vector<double> expect = {4, 5, 6, 7, 8, 9};
+		EXPECT_ARREQ(expect, got);
+	}
+}
+
+
+
+TEST(SERIALIZE, MappedGraph)
+{
+	std::string path = "mapped_graph.stream";
+	ade::Shape shape({3, 2});
+	llo::VarptrT x = llo::get_variable<double>(
+		std::vector<double>{1, 2, 3, 4, 5, 6}, shape, "x");
+	llo::VarptrT y = llo::get_variable<double>(
+		std::vector<double>{6, 5, 4, 3, 2, 1}, shape, "y");
+	llo::ConstptrT three = llo::get_scalar<double>(3, shape);
+	ade::TensptrT root = age::add(age::mul(x, y), three);
+	pbm::PathedMapT labels = {
+		{x, {"x"}},
+		{y, {"y"}},
+		{root, {"root"}},
+	};
+
+	std::unordered_map<std::string,pbm::ChunkRef> chunks;
+	pbm::ChunkLoaderT loader =
+		[&](const pbm::ChunkRef& chunk, ade::Shape shape, size_t typecode,
+			std::string label, pbm::LeafInfo info) -> ade::TensptrT
+		{
+			chunks.emplace(label, chunk);
+			if (nullptr != info.value_)
+			{
+				return llo::deserialize(info.value_, shape, typecode,
+					label, info);
+			}
+			if (chunk.raw_)
+			{
+				return llo::map_deserialize(chunk.path_, chunk.offset_,
+					shape, typecode, label, info.constant_);
+			}
+			return llo::lazy_deserialize(chunk.fetch_, shape, typecode,
+				label, info);
+		};
+	std::vector<double> expect = {9, 13, 15, 15, 13, 9};
+	for (uint32_t codec : {pbm::RAW_CODEC, pbm::ZSTD_CODEC})
+	{
+		pbm::GraphSaver saver(llo::serialize, llo::leaf_info, codec);
+		root->accept(saver);
+		{
+			std::ofstream out(path, std::ios::out | std::ios::binary);
+			ASSERT_TRUE(out.is_open());
+			saver.save(out, labels);
+		}
+
+		chunks.clear();
+		pbm::GraphInfo info;
+		pbm::load_graph(info, path, loader);
+		ASSERT_EQ(3, chunks.size());
+		ade::TensptrT gotx = info.tens_.get_labelled({"x"});
+		ade::TensptrT gotroot = info.tens_.get_labelled({"root"});
+		ASSERT_NE(nullptr, gotx);
+		ASSERT_NE(nullptr, gotroot);
+
+		llo::GenericData out = llo::eval(gotroot, age::DOUBLE);
+		double* ptr = (double*) out.data_.get();
+		std::vector<double> got(ptr, ptr + out.shape_.n_elems());
+		EXPECT_ARREQ(expect, got);
+
+		const pbm::ChunkRef& xchunk = chunks["x"];
+		EXPECT_EQ(codec == pbm::RAW_CODEC, xchunk.raw_);
+		if (xchunk.raw_)
+		{
+			EXPECT_EQ(0, xchunk.offset_ % pbm::chunk_align);
+			EXPECT_EQ(shape.n_elems() * sizeof(double), xchunk.size_);
+			ASSERT_NE(nullptr, dynamic_cast<llo::Variable*>(gotx.get()));
+
+			// mapped data reads the file in place
+			{
+				std::fstream file(path,
+					std::ios::in | std::ios::out | std::ios::binary);
+				double first = 100;
+				file.seekp(xchunk.offset_);
+				file.write((const char*) &first, sizeof(double));
+			}
+			EXPECT_EQ(100, *((const double*) static_cast<llo::Variable*>(
+				gotx.get())->data()));
+		}
+		else
+		{
+			EXPECT_NE(nullptr, dynamic_cast<llo::LazyVariable*>(gotx.get()));
+		}
+	}
+	std::remove(path.c_str());
+}
+
+
+TEST(SERIALIZE, LazyGraph)
+{
+	std::string path = "lazy_graph.stream";
+	ade::Shape shape({3, 2});
+	llo::VarptrT x = llo::get_variable<double>(
+		std::vector<double>{1, 2, 3, 4, 5, 6}, shape, "x");
+	llo::VarptrT zero = llo::get_variable<double>(shape, "zero");
+	zero->constant_ = true;
+	llo::ConstptrT three = llo::get_scalar<double>(3, shape);
+	ade::TensptrT root = age::add(age::mul(x, zero), three);
+
+	pbm::GraphSaver saver(llo::serialize, llo::leaf_info, pbm::ZSTD_CODEC);
+	root->accept(saver);
+	{
+		std::ofstream out(path, std::ios::out | std::ios::binary);
+		ASSERT_TRUE(out.is_open());
+		saver.save(out, pbm::PathedMapT{
+			{x, {"x"}},
+			{zero, {"zero"}},
+			{three, {"three"}},
+			{root, {"root"}},
+		});
+	}
+
+	pbm::GraphInfo info;
+	pbm::load_graph(info, path, llo::lazy_deserialize);
+	ade::TensptrT gotx = info.tens_.get_labelled({"x"});
+	ade::TensptrT gotzero = info.tens_.get_labelled({"zero"});
+	ade::TensptrT gotthree = info.tens_.get_labelled({"three"});
+	ade::TensptrT gotroot = info.tens_.get_labelled({"root"});
+	ASSERT_NE(nullptr, gotx);
+	ASSERT_NE(nullptr, gotzero);
+	ASSERT_NE(nullptr, gotthree);
+	ASSERT_NE(nullptr, gotroot);
+
+	auto lazyx = dynamic_cast<llo::LazyVariable*>(gotx.get());
+	auto lazyzero = dynamic_cast<llo::LazyVariable*>(gotzero.get());
+	ASSERT_NE(nullptr, lazyx);
+	ASSERT_NE(nullptr, lazyzero);
+	EXPECT_FALSE(lazyx->constant_);
+	EXPECT_TRUE(lazyzero->constant_);
+	EXPECT_NE(nullptr, dynamic_cast<llo::Constant*>(gotthree.get()));
+	EXPECT_TRUE(llo::is_constant(lazyzero));
+
+	// optimizing never fetches data
+	ade::TensptrT pruned = llo::zero_prune(gotroot);
+	ade::TensptrT merged = llo::merge_common(pruned);
+	EXPECT_FALSE(lazyx->is_loaded());
+	EXPECT_FALSE(lazyzero->is_loaded());
+
+	llo::GenericData out = llo::eval(merged, age::DOUBLE);
+	double* ptr = (double*) out.data_.get();
+	std::vector<double> got(ptr, ptr + out.shape_.n_elems());
+	std::vector<double> expect = {3, 3, 3, 3, 3, 3};
+	EXPECT_ARREQ(expect, got);
+
+	// fetched constants are pruned like loaded ones
+	EXPECT_TRUE(lazyzero->is_loaded());
+	ade::TensptrT reroot = llo::zero_prune(gotroot);
+	auto repruned = dynamic_cast<ade::iFunctor*>(reroot.get());
+	ASSERT_NE(nullptr, repruned);
+	ASSERT_EQ(1, repruned->get_children().size());
+	EXPECT_EQ(gotthree, repruned->get_children()[0].get_tensor());
+	std::remove(path.c_str());
+}
+
+
+#endif // DISABLE_SERIALIZE_TEST
@@ -22,9 +22,23 @@ namespace llo
 /// For example, add(x, 0) is converted to simply x, while mul(x, 0) is 0
 ade::TensptrT zero_prune (ade::TensptrT root);
 
+/// Return trees of every root with zero branches pruned in one pass,
+/// where subgraphs shared between roots are pruned once
+ade::TensT zero_prune (ade::TensT roots);
+
+/// Map of derivation targets to gradients
+using GradsT = std::unordered_map<ade::iTensor*,ade::TensptrT>;
+
 /// Derive root with respect to target with zero branches pruned
 ade::TensptrT derive (ade::TensptrT root, ade::iTensor* target);
 
+/// Derive root with respect to every target with zero branches pruned
+/// Adjoints are accumulated in one reverse topological sweep over the
+/// union of paths to targets, gradients are zero pruned together and
+/// equal subgraphs are shared between gradients, so deriving n targets
+/// costs one traversal instead of n
+GradsT derive (ade::TensptrT root, std::vector<ade::iTensor*> targets);
+
 }
 
 #endif // LLO_ZPRUNE_HPP
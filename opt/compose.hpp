@@ -0,0 +1,234 @@
+///
+/// compose.hpp
+/// opt
+///
+/// Purpose:
+/// Define ade graph composition of data movement mappings
+///
+
+#include <cmath>
+#include <functional>
+#include <unordered_map>
+
+#include "ade/ade.hpp"
+
+#include "opt/rebuild.hpp"
+
+#ifndef OPT_COMPOSE_HPP
+#define OPT_COMPOSE_HPP
+
+namespace opt
+{
+
+/// Predicate for functors whose opcode copies its only argument
+/// (e.g.: single argument sums), so the functor's output is exactly its
+/// argument after mapping whenever the mapping is one-to-one
+using MovementT = std::function<bool(ade::iFunctor*)>;
+
+/// Predicate for functors whose evaluation honors every argument's
+/// coorder, so arguments can be remapped without changing results
+using RemappableT = std::function<bool(ade::iFunctor*)>;
+
+/// Return coordinate map applying first then second
+inline ade::CoordptrT compose_coord (
+	const ade::iCoordMap& first, const ade::iCoordMap& second)
+{
+	return std::make_shared<ade::CoordMap>(
+		[&](ade::MatrixT out)
+		{
+			first.access(
+				[&](const ade::MatrixT& fmat)
+				{
+					second.access(
+						[&](const ade::MatrixT& smat)
+						{
+							for (uint8_t i = 0; i < ade::mat_dim; ++i)
+							{
+								for (uint8_t j = 0; j < ade::mat_dim; ++j)
+								{
+									out[i][j] = 0;
+									for (uint8_t k = 0; k < ade::mat_dim; ++k)
+									{
+										out[i][j] += fmat[i][k] * smat[k][j];
+									}
+								}
+							}
+						});
+				});
+		});
+}
+
+/// Return true if every entry of coord is an integer,
+/// so applying it never truncates coordinates
+inline bool is_integral (const ade::iCoordMap& coord)
+{
+	bool integral = true;
+	coord.access(
+		[&](const ade::MatrixT& mat)
+		{
+			for (uint8_t i = 0; i < ade::mat_dim; ++i)
+			{
+				for (uint8_t j = 0; j < ade::mat_dim; ++j)
+				{
+					integral = integral && mat[i][j] == std::round(mat[i][j]);
+				}
+			}
+		});
+	return integral;
+}
+
+/// Return true if coord only permutes and flips dimensions, so every input
+/// coordinate maps to a distinct output coordinate and vice versa
+inline bool is_bijective (const ade::iCoordMap& coord)
+{
+	bool bijective = true;
+	coord.access(
+		[&](const ade::MatrixT& mat)
+		{
+			for (uint8_t i = 0; i < ade::rank_cap; ++i)
+			{
+				uint8_t nrow = 0;
+				uint8_t ncol = 0;
+				for (uint8_t j = 0; j < ade::rank_cap; ++j)
+				{
+					if (0 != mat[i][j])
+					{
+						bijective = bijective && 1 == std::abs(mat[i][j]);
+						++nrow;
+					}
+					if (0 != mat[j][i])
+					{
+						++ncol;
+					}
+				}
+				bijective = bijective && 1 == nrow && 1 == ncol;
+			}
+		});
+	return bijective;
+}
+
+/// Remove functors that only move data by mapping their consumers
+/// directly onto the moved tensor through one composed coordinate map
+/// Consumers pushing through movers that push one-to-one are remapped by
+/// the mover's push then the consumer's, otherwise both mappings are
+/// converted to pulls (inverting one-to-one pushes) and composed in
+/// reverse, provided the consumer's pull is integral
+struct MapComposer final
+{
+	MapComposer (MovementT is_movement, RemappableT is_remappable,
+		RebuildT rebuild = rebuild_functor) :
+		is_movement_(is_movement), is_remappable_(is_remappable),
+		rebuild_(rebuild) {}
+
+	/// Return graph of root with movement functors composed into consumers
+	ade::TensptrT compose (ade::TensptrT root)
+	{
+		converted_.clear();
+		return convert(root);
+	}
+
+private:
+	/// Return arg remapped to read the argument of its movement functor,
+	/// or arg itself if the mappings cannot be composed
+	ade::MappedTensor remap (const ade::MappedTensor& arg)
+	{
+		auto mover = dynamic_cast<ade::iFunctor*>(arg.get_tensor().get());
+		if (nullptr == mover || 1 != mover->get_children().size() ||
+			false == is_movement_(mover))
+		{
+			return arg;
+		}
+		const ade::MappedTensor& moved = mover->get_children()[0];
+		ade::CoordptrT shaper = compose_coord(
+			*moved.get_shaper(), *arg.get_shaper());
+		// pushing through a mover requires that the mover pushes every
+		// element to exactly one position
+		bool moved_onto = moved.map_io() &&
+			is_bijective(*moved.get_coorder()) &&
+			is_integral(*moved.get_coorder());
+		if (arg.map_io() && moved_onto)
+		{
+			return ade::MappedTensor(moved.get_tensor(), shaper, true,
+				compose_coord(*moved.get_coorder(), *arg.get_coorder()));
+		}
+		// otherwise pull through the mover, inverting one-to-one pushes
+		ade::CoordptrT arg_pull = arg.get_coorder();
+		if (arg.map_io())
+		{
+			if (false == is_bijective(*arg_pull))
+			{
+				return arg;
+			}
+			arg_pull = ade::CoordptrT(arg_pull->reverse());
+		}
+		ade::CoordptrT moved_pull = moved.get_coorder();
+		if (moved.map_io())
+		{
+			if (false == moved_onto)
+			{
+				return arg;
+			}
+			moved_pull = ade::CoordptrT(moved_pull->reverse());
+		}
+		if (false == is_integral(*arg_pull))
+		{
+			return arg;
+		}
+		return ade::MappedTensor(moved.get_tensor(), shaper, false,
+			compose_coord(*arg_pull, *moved_pull));
+	}
+
+	/// Return tens with movement functors in its subgraph composed
+	ade::TensptrT convert (ade::TensptrT tens)
+	{
+		auto it = converted_.find(tens.get());
+		if (converted_.end() != it)
+		{
+			return it->second;
+		}
+		ade::TensptrT out = tens;
+		if (auto func = dynamic_cast<ade::iFunctor*>(tens.get()))
+		{
+			bool remappable = is_remappable_(func);
+			const ade::ArgsT& children = func->get_children();
+			ade::ArgsT args;
+			bool changed = false;
+			for (const ade::MappedTensor& child : children)
+			{
+				ade::TensptrT ctens = convert(child.get_tensor());
+				ade::MappedTensor arg(ctens, child.get_shaper(),
+					child.map_io(), child.get_coorder());
+				if (remappable)
+				{
+					// movers are already composed with their own arguments,
+					// so composing once reaches through the whole chain
+					arg = remap(arg);
+				}
+				changed = changed || arg.get_tensor() != child.get_tensor();
+				args.push_back(arg);
+			}
+			if (changed)
+			{
+				out = rebuild_(func, args);
+			}
+		}
+		converted_.emplace(tens.get(), out);
+		return out;
+	}
+
+	/// Predicate for movement functors
+	MovementT is_movement_;
+
+	/// Predicate for functors whose arguments can be remapped
+	RemappableT is_remappable_;
+
+	/// Builder of functors with composed arguments
+	RebuildT rebuild_;
+
+	/// Map of original tensor to its replacement
+	std::unordered_map<ade::iTensor*,ade::TensptrT> converted_;
+};
+
+}
+
+#endif // OPT_COMPOSE_HPP
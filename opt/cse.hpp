@@ -0,0 +1,182 @@
+///
+/// cse.hpp
+/// opt
+///
+/// Purpose:
+/// Define ade graph common subexpression elimination
+///
+
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+
+#include "ade/ade.hpp"
+
+#include "opt/rebuild.hpp"
+
+#ifndef OPT_CSE_HPP
+#define OPT_CSE_HPP
+
+namespace opt
+{
+
+/// Functor returning key of leaf content, leaves with the same nonempty key
+/// are interchangeable, leaves with empty keys are only equal to themselves
+using LeafKeyT = std::function<std::string(ade::iLeaf*)>;
+
+/// Predicate confirming leaves of the same key are interchangeable,
+/// for keys that only hash leaf content
+using LeafEqualT = std::function<bool(ade::iLeaf*,ade::iLeaf*)>;
+
+/// Predicate for whether functor can be merged with structurally equal
+/// functors, nondeterministic functors (e.g.: random sampling) never are
+using MergeableT = std::function<bool(ade::iFunctor*)>;
+
+/// Hash-cons graphs so structurally equal subgraphs are represented once
+/// Functors are equal if they share opcode and every child maps the same
+/// (merged) tensor with equal shaper, coorder and direction
+struct CSE final
+{
+	CSE (LeafKeyT leaf_key, MergeableT mergeable =
+		[](ade::iFunctor*) { return true; },
+		RebuildT rebuild = rebuild_functor, LeafEqualT leaf_equal =
+		[](ade::iLeaf*, ade::iLeaf*) { return true; }) :
+		leaf_key_(leaf_key), mergeable_(mergeable),
+		rebuild_(rebuild), leaf_equal_(leaf_equal) {}
+
+	/// Return graph of root where equal subgraphs are merged
+	/// Merged nodes are kept between calls, so graphs converted by the
+	/// same CSE instance share subgraphs with each other as well
+	ade::TensptrT merge (ade::TensptrT root)
+	{
+		auto it = converted_.find(root.get());
+		if (converted_.end() != it)
+		{
+			return it->second;
+		}
+		std::string key;
+		ade::TensptrT out = root;
+		if (auto func = dynamic_cast<ade::iFunctor*>(root.get()))
+		{
+			size_t code = func->get_opcode().code_;
+			append(key, &code, sizeof(code));
+			const ade::ArgsT& children = func->get_children();
+			ade::ArgsT args;
+			bool changed = false;
+			for (const ade::MappedTensor& child : children)
+			{
+				ade::TensptrT ctens = merge(child.get_tensor());
+				changed = changed || ctens != child.get_tensor();
+				args.push_back(ade::MappedTensor(ctens,
+					child.get_shaper(), child.map_io(),
+					child.get_coorder()));
+
+				ade::iTensor* cptr = ctens.get();
+				bool fwd = child.map_io();
+				append(key, &cptr, sizeof(cptr));
+				append(key, &fwd, sizeof(fwd));
+				append_coord(key, child.get_shaper());
+				append_coord(key, child.get_coorder());
+			}
+			key = func->get_opcode().name_ + key;
+			bool mergeable = mergeable_(func);
+			auto cit = canon_.find(key);
+			if (mergeable && canon_.end() != cit)
+			{
+				out = cit->second;
+			}
+			else
+			{
+				if (changed)
+				{
+					out = rebuild_(func, args);
+				}
+				if (mergeable)
+				{
+					canon_.emplace(key, out);
+				}
+			}
+		}
+		else if (auto leaf = dynamic_cast<ade::iLeaf*>(root.get()))
+		{
+			key = leaf_key_(leaf);
+			if (false == key.empty())
+			{
+				// leaves of colliding keys are told apart by leaf_equal_
+				ade::TensT& equals = leaves_[key];
+				auto eit = std::find_if(equals.begin(), equals.end(),
+					[&](const ade::TensptrT& other)
+					{
+						return leaf_equal_(leaf,
+							static_cast<ade::iLeaf*>(other.get()));
+					});
+				if (equals.end() != eit)
+				{
+					out = *eit;
+				}
+				else
+				{
+					equals.push_back(out);
+				}
+			}
+		}
+		if (out != root)
+		{
+			// keep root alive so its address is never reused by a
+			// different tensor while it is a key of converted_
+			retained_.push_back(root);
+		}
+		converted_.emplace(root.get(), out);
+		return out;
+	}
+
+private:
+	/// Append bytes of value to key
+	static void append (std::string& key, const void* value, size_t n)
+	{
+		key.append((const char*) value, n);
+	}
+
+	/// Append matrix of coord to key
+	static void append_coord (std::string& key, ade::CoordptrT coord)
+	{
+		if (nullptr == coord)
+		{
+			key.push_back('\0');
+			return;
+		}
+		coord->access(
+			[&](const ade::MatrixT& mat)
+			{
+				append(key, mat, sizeof(ade::MatrixT));
+			});
+	}
+
+	/// Functor returning leaf content key
+	LeafKeyT leaf_key_;
+
+	/// Predicate for mergeable functors
+	MergeableT mergeable_;
+
+	/// Builder of functors with merged children
+	RebuildT rebuild_;
+
+	/// Predicate confirming leaves of equal keys are interchangeable
+	LeafEqualT leaf_equal_;
+
+	/// Map of original tensor to its merged tensor
+	std::unordered_map<ade::iTensor*,ade::TensptrT> converted_;
+
+	/// Original tensors replaced by merged tensors
+	ade::TensT retained_;
+
+	/// Map of structural key to canonical tensor
+	std::unordered_map<std::string,ade::TensptrT> canon_;
+
+	/// Map of leaf key to canonical leaves of that key
+	std::unordered_map<std::string,ade::TensT> leaves_;
+};
+
+}
+
+#endif // OPT_CSE_HPP
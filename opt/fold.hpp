@@ -0,0 +1,136 @@
+///
+/// fold.hpp
+/// opt
+///
+/// Purpose:
+/// Define ade graph folding of constant subgraphs into leaves
+///
+
+#include <functional>
+#include <unordered_map>
+
+#include "ade/ade.hpp"
+
+#include "opt/rebuild.hpp"
+
+#ifndef OPT_FOLD_HPP
+#define OPT_FOLD_HPP
+
+namespace opt
+{
+
+/// Predicate for whether leaf holds data that never changes
+using IsConstT = std::function<bool(ade::iLeaf*)>;
+
+/// Predicate for whether functor of constant children is itself constant
+/// Nondeterministic functors (e.g.: random sampling) are never constant
+using FoldableT = std::function<bool(ade::iFunctor*)>;
+
+/// Functor returning leaf holding the evaluated data of constant functor
+using FoldT = std::function<ade::TensptrT(ade::iFunctor*)>;
+
+/// Replace every maximal subgraph whose leaves are all constant with
+/// the leaf built by fold, so each such subgraph is evaluated only once
+struct ConstFolder final
+{
+	ConstFolder (IsConstT is_const, FoldableT foldable, FoldT fold,
+		RebuildT rebuild = rebuild_functor) :
+		is_const_(is_const), foldable_(foldable),
+		fold_(fold), rebuild_(rebuild) {}
+
+	/// Return graph of root with constant subgraphs folded
+	ade::TensptrT fold (ade::TensptrT root)
+	{
+		consts_.clear();
+		converted_.clear();
+		return convert(root);
+	}
+
+private:
+	/// Return true if tens is a constant leaf or a foldable functor of
+	/// constant children
+	bool is_const (ade::iTensor* tens)
+	{
+		auto it = consts_.find(tens);
+		if (consts_.end() != it)
+		{
+			return it->second;
+		}
+		bool out;
+		if (auto func = dynamic_cast<ade::iFunctor*>(tens))
+		{
+			out = foldable_(func);
+			for (const ade::MappedTensor& child : func->get_children())
+			{
+				// check every child to memoize the whole subgraph
+				out = is_const(child.get_tensor().get()) && out;
+			}
+		}
+		else
+		{
+			out = is_const_(static_cast<ade::iLeaf*>(tens));
+		}
+		consts_.emplace(tens, out);
+		return out;
+	}
+
+	/// Return tens with constant functors in its subgraph folded
+	ade::TensptrT convert (ade::TensptrT tens)
+	{
+		auto it = converted_.find(tens.get());
+		if (converted_.end() != it)
+		{
+			return it->second;
+		}
+		ade::TensptrT out = tens;
+		if (auto func = dynamic_cast<ade::iFunctor*>(tens.get()))
+		{
+			if (is_const(func))
+			{
+				out = fold_(func);
+			}
+			else
+			{
+				const ade::ArgsT& children = func->get_children();
+				ade::ArgsT args;
+				bool changed = false;
+				for (const ade::MappedTensor& child : children)
+				{
+					ade::TensptrT ctens = convert(child.get_tensor());
+					changed = changed || ctens != child.get_tensor();
+					args.push_back(ade::MappedTensor(ctens,
+						child.get_shaper(), child.map_io(),
+						child.get_coorder()));
+				}
+				if (changed)
+				{
+					out = rebuild_(func, args);
+				}
+			}
+		}
+		converted_.emplace(tens.get(), out);
+		return out;
+	}
+
+	/// Predicate for constant leaves
+	IsConstT is_const_;
+
+	/// Predicate for foldable functors
+	FoldableT foldable_;
+
+	/// Builder of folded leaves
+	FoldT fold_;
+
+	/// Builder of functors with folded children
+	RebuildT rebuild_;
+
+	/// Map of visited tensors to whether they are constant
+	std::unordered_map<ade::iTensor*,bool> consts_;
+
+	/// Map of original tensor to its replacement
+	std::unordered_map<ade::iTensor*,ade::TensptrT> converted_;
+};
+
+}
+
+#endif // OPT_FOLD_HPP
@@ -0,0 +1,157 @@
+///
+/// fuse.hpp
+/// opt
+///
+/// Purpose:
+/// Define ade graph fusion of connected functors into single nodes
+///
+
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+
+#include "ade/ade.hpp"
+
+#include "opt/rebuild.hpp"
+
+#ifndef OPT_FUSE_HPP
+#define OPT_FUSE_HPP
+
+namespace opt
+{
+
+/// Predicate for whether functor can be fused with its fusable neighbors
+using FusableT = std::function<bool(ade::iFunctor*)>;
+
+/// Builder of node replacing fused region rooted at subroot, where
+/// boundary[i] is a tensor outside of region read by the region's functors
+/// and inputs[i] is the tensor the replacement node should read instead
+using FuseBuilderT = std::function<ade::TensptrT(ade::iFunctor*,
+	std::vector<ade::iTensor*>,ade::TensT)>;
+
+/// Replace maximal regions of fusable functors with nodes built by builder
+/// A region grows from a fusable functor through fusable children consumed
+/// by no other node, so every fused functor is evaluated exactly once
+/// Regions with a single functor are left unfused
+struct Fuser final
+{
+	Fuser (FusableT fusable, FuseBuilderT builder,
+		RebuildT rebuild = rebuild_functor) :
+		fusable_(fusable), builder_(builder), rebuild_(rebuild) {}
+
+	/// Return graph of root with fusable regions replaced
+	ade::TensptrT fuse (ade::TensptrT root)
+	{
+		nconsumers_.clear();
+		converted_.clear();
+		count(root.get());
+		return convert(root);
+	}
+
+private:
+	/// Count number of edges to every node reachable from tens
+	void count (ade::iTensor* tens)
+	{
+		if (nconsumers_.end() != nconsumers_.find(tens))
+		{
+			return;
+		}
+		nconsumers_.emplace(tens, 0);
+		if (auto func = dynamic_cast<ade::iFunctor*>(tens))
+		{
+			for (const ade::MappedTensor& child : func->get_children())
+			{
+				ade::iTensor* ctens = child.get_tensor().get();
+				count(ctens);
+				++nconsumers_[ctens];
+			}
+		}
+	}
+
+	/// Collect tensors read by region grown from func into boundary
+	/// Return number of functors in the region
+	size_t grow (ade::iFunctor* func, std::vector<ade::iTensor*>& boundary,
+		ade::TensT& inputs)
+	{
+		size_t nfuncs = 1;
+		for (const ade::MappedTensor& child : func->get_children())
+		{
+			ade::TensptrT ctens = child.get_tensor();
+			auto cfunc = dynamic_cast<ade::iFunctor*>(ctens.get());
+			if (nullptr != cfunc && 1 == nconsumers_[cfunc] && fusable_(cfunc))
+			{
+				nfuncs += grow(cfunc, boundary, inputs);
+			}
+			else if (boundary.end() ==
+				std::find(boundary.begin(), boundary.end(), ctens.get()))
+			{
+				boundary.push_back(ctens.get());
+				inputs.push_back(ctens);
+			}
+		}
+		return nfuncs;
+	}
+
+	/// Return tens with regions in its subgraph replaced
+	ade::TensptrT convert (ade::TensptrT tens)
+	{
+		auto it = converted_.find(tens.get());
+		if (converted_.end() != it)
+		{
+			return it->second;
+		}
+		ade::TensptrT out = tens;
+		if (auto func = dynamic_cast<ade::iFunctor*>(tens.get()))
+		{
+			std::vector<ade::iTensor*> boundary;
+			ade::TensT inputs;
+			if (fusable_(func) && grow(func, boundary, inputs) > 1)
+			{
+				for (ade::TensptrT& input : inputs)
+				{
+					input = convert(input);
+				}
+				out = builder_(func, boundary, inputs);
+			}
+			else
+			{
+				const ade::ArgsT& children = func->get_children();
+				ade::ArgsT args;
+				bool changed = false;
+				for (const ade::MappedTensor& child : children)
+				{
+					ade::TensptrT ctens = convert(child.get_tensor());
+					changed = changed || ctens != child.get_tensor();
+					args.push_back(ade::MappedTensor(ctens,
+						child.get_shaper(), child.map_io(),
+						child.get_coorder()));
+				}
+				if (changed)
+				{
+					out = rebuild_(func, args);
+				}
+			}
+		}
+		converted_.emplace(tens.get(), out);
+		return out;
+	}
+
+	/// Predicate for fusable functors
+	FusableT fusable_;
+
+	/// Builder of fused nodes
+	FuseBuilderT builder_;
+
+	/// Builder of unfused functors with fused children
+	RebuildT rebuild_;
+
+	/// Map of tensor to number of edges to it
+	std::unordered_map<ade::iTensor*,size_t> nconsumers_;
+
+	/// Map of original tensor to its replacement
+	std::unordered_map<ade::iTensor*,ade::TensptrT> converted_;
+};
+
+}
+
+#endif // OPT_FUSE_HPP
@@ -0,0 +1,32 @@
+///
+/// rebuild.hpp
+/// opt
+///
+/// Purpose:
+/// Define rebuilding of functors whose children are replaced by passes
+///
+
+#include <functional>
+
+#include "ade/ade.hpp"
+
+#ifndef OPT_REBUILD_HPP
+#define OPT_REBUILD_HPP
+
+namespace opt
+{
+
+/// Builder of node replacing func after its children are replaced by args
+/// Passes rebuild through this so functors other than ade::Functor
+/// (e.g.: nodes built by Fuser) keep their own type
+using RebuildT = std::function<ade::TensptrT(ade::iFunctor*,ade::ArgsT)>;
+
+/// Return ade::Functor of func's opcode over args
+inline ade::TensptrT rebuild_functor (ade::iFunctor* func, ade::ArgsT args)
+{
+	return ade::TensptrT(ade::Functor::get(func->get_opcode(), args));
+}
+
+}
+
+#endif // OPT_REBUILD_HPP
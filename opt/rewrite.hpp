@@ -0,0 +1,115 @@
+///
+/// rewrite.hpp
+/// opt
+///
+/// Purpose:
+/// Define ade graph rewriting according to per-opcode rules
+///
+
+#include <functional>
+#include <unordered_map>
+
+#include "ade/ade.hpp"
+
+#include "opt/rebuild.hpp"
+
+#ifndef OPT_REWRITE_HPP
+#define OPT_REWRITE_HPP
+
+namespace opt
+{
+
+/// Rule returning replacement of functor whose children are already
+/// rewritten, or nullptr if the rule does not apply
+using RuleT = std::function<ade::TensptrT(ade::iFunctor*)>;
+
+/// Map of opcode code to rules tried in order on functors of that opcode
+using RulesT = std::unordered_map<size_t,std::vector<RuleT>>;
+
+/// Rewrite graphs bottom-up, where every functor is replaced by the
+/// result of the first applicable rule of its opcode
+/// Replacements are rewritten in turn until no rule applies, so one pass
+/// reaches the fixpoint of every subgraph before visiting its parents
+/// Rules must make progress (e.g.: shrink the graph) to terminate
+struct Rewriter final
+{
+	Rewriter (RulesT rules, RebuildT rebuild = rebuild_functor) :
+		rules_(rules), rebuild_(rebuild) {}
+
+	/// Return graph of root with rules applied until fixpoint
+	ade::TensptrT rewrite (ade::TensptrT root)
+	{
+		ade::TensptrT out = convert(root);
+		converted_.clear();
+		retained_.clear();
+		return out;
+	}
+
+private:
+	/// Return tens with rules applied to its subgraph
+	ade::TensptrT convert (ade::TensptrT tens)
+	{
+		auto it = converted_.find(tens.get());
+		if (converted_.end() != it)
+		{
+			return it->second;
+		}
+		ade::TensptrT out = tens;
+		if (auto func = dynamic_cast<ade::iFunctor*>(tens.get()))
+		{
+			const ade::ArgsT& children = func->get_children();
+			ade::ArgsT args;
+			bool changed = false;
+			for (const ade::MappedTensor& child : children)
+			{
+				ade::TensptrT ctens = convert(child.get_tensor());
+				changed = changed || ctens != child.get_tensor();
+				args.push_back(ade::MappedTensor(ctens,
+					child.get_shaper(), child.map_io(),
+					child.get_coorder()));
+			}
+			if (changed)
+			{
+				out = rebuild_(func, args);
+				func = static_cast<ade::iFunctor*>(out.get());
+			}
+			auto rit = rules_.find(func->get_opcode().code_);
+			if (rules_.end() != rit)
+			{
+				for (const RuleT& rule : rit->second)
+				{
+					if (ade::TensptrT repl = rule(func))
+					{
+						// children of replacement are mostly rewritten,
+						// so rewriting it again is shallow
+						out = convert(repl);
+						break;
+					}
+				}
+			}
+		}
+		// keep tens alive while its address is a key of converted_,
+		// since intermediate replacements are otherwise released
+		retained_.push_back(tens);
+		converted_.emplace(tens.get(), out);
+		// rewritten tensors are fixed points of the rules
+		converted_.emplace(out.get(), out);
+		return out;
+	}
+
+	/// Rules of every opcode
+	RulesT rules_;
+
+	/// Builder of functors with rewritten children
+	RebuildT rebuild_;
+
+	/// Map of visited tensor to its rewritten tensor
+	std::unordered_map<ade::iTensor*,ade::TensptrT> converted_;
+
+	/// Tensors visited during rewrite
+	ade::TensT retained_;
+};
+
+}
+
+#endif // OPT_REWRITE_HPP
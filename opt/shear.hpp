@@ -39,7 +39,8 @@ struct LeafFinder final : public ade::iTraveler
 	/// Implementation of iTraveler
 	void visit (ade::iLeaf* leaf) override
 	{
-		if (target_ == get_leaf_(leaf))
+		if (visited_.emplace(leaf).second &&
+			target_ == get_leaf_(leaf))
 		{
 			founds_.emplace(leaf);
 		}
@@ -48,7 +49,7 @@ struct LeafFinder final : public ade::iTraveler
 	/// Implementation of iTraveler
 	void visit (ade::iFunctor* func) override
 	{
-		if (parents_.end() == parents_.find(func))
+		if (visited_.emplace(func).second)
 		{
 			auto& children = func->get_children();
 			size_t n = children.size();
@@ -81,6 +82,9 @@ struct LeafFinder final : public ade::iTraveler
 
 	/// Map of parent nodes in path
 	ParentMapT parents_;
+
+	/// Set of nodes already visited, so shared subgraphs are visited once
+	std::unordered_set<ade::iTensor*> visited_;
 };
 
 /// For some target extractable from iLeaf, prune graph such that reduces the
@@ -95,17 +99,31 @@ struct TargetPruner
 
 	/// Prune graph of root Tensptr
 	ade::TensptrT prune (ade::TensptrT root)
+	{
+		return prune(ade::TensT{root})[0];
+	}
+
+	/// Prune graphs of every root in one pass, where subgraphs shared
+	/// between roots are searched and pruned once
+	/// Return pruned roots in the order of roots
+	ade::TensT prune (ade::TensT roots)
 	{
 		// assert that context will be unaffected by prune,
 		// since source will never be touched
-		root->accept(finder_);
+		for (ade::TensptrT& root : roots)
+		{
+			root->accept(finder_);
+		}
 		auto& pathmap = finder_.parents_;
 		if (pathmap.empty()) // not path to target or root is not a parent
 		{
-			return root;
+			return roots;
 		}
 		ade::GraphStat stat;
-		root->accept(stat);
+		for (ade::TensptrT& root : roots)
+		{
+			root->accept(stat);
+		}
 		// grab the intersection of stat.funcs_ and pathmap
 		std::list<ade::iFunctor*> parents;
 		std::transform(pathmap.begin(), pathmap.end(),
@@ -157,13 +175,14 @@ struct TargetPruner
 				}
 			}
 		}
-		auto it = mapping.find(root.get());
-		if (mapping.end() == it)
+		// roots without paths to target are unchanged
+		ade::TensT out;
+		for (ade::TensptrT& root : roots)
 		{
-			logs::fatal(
-				"GraphStat failed to identify children of root subgraph");
+			auto it = mapping.find(root.get());
+			out.push_back(mapping.end() == it ? root : it->second);
 		}
-		return it->second;
+		return out;
 	}
 
 private:
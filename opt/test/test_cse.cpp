@@ -0,0 +1,173 @@
+
+#ifndef DISABLE_CSE_TEST
+
+
+#include "gtest/gtest.h"
+
+#include "opt/cse.hpp"
+
+
+struct ValuedLeaf final : public ade::iLeaf
+{
+	ValuedLeaf (double val, bool mergeable) :
+		val_(val), mergeable_(mergeable) {}
+
+	const ade::Shape& shape (void) const override
+	{
+		return shape_;
+	}
+
+	std::string to_string (void) const override
+	{
+		return shape_.to_string();
+	}
+
+	void* data (void) override
+	{
+		return &val_;
+	}
+
+	const void* data (void) const override
+	{
+		return &val_;
+	}
+
+	size_t type_code (void) const override
+	{
+		return 0;
+	}
+
+	double val_;
+
+	bool mergeable_;
+
+	ade::Shape shape_;
+};
+
+
+TEST(CSE, Merge)
+{
+    ade::TensptrT one(new ValuedLeaf(1, true));
+    ade::TensptrT one2(new ValuedLeaf(1, true));
+    ade::TensptrT var(new ValuedLeaf(1, false));
+    ade::TensptrT var2(new ValuedLeaf(1, false));
+
+    ade::TensptrT unar(ade::Functor::get(
+        ade::Opcode{"unary", 0}, {ade::identity_map(var)}));
+    ade::TensptrT unar2(ade::Functor::get(
+        ade::Opcode{"unary", 0}, {ade::identity_map(var)}));
+    ade::TensptrT unar3(ade::Functor::get(
+        ade::Opcode{"unary", 0}, {ade::identity_map(var2)}));
+    ade::TensptrT flipped(ade::Functor::get(
+        ade::Opcode{"unary", 0}, {ade::flip_map(var, 0)}));
+    ade::TensptrT binar(ade::Functor::get(
+        ade::Opcode{"binary", 1}, {
+            ade::identity_map(unar),
+            ade::identity_map(one),
+        }));
+    ade::TensptrT binar2(ade::Functor::get(
+        ade::Opcode{"binary", 1}, {
+            ade::identity_map(unar2),
+            ade::identity_map(one2),
+        }));
+    ade::TensptrT root(ade::Functor::get(
+        ade::Opcode{"nnary", 2}, {
+            ade::identity_map(binar),
+            ade::identity_map(binar2),
+            ade::identity_map(unar3),
+            ade::identity_map(flipped),
+        }));
+
+    opt::CSE cse([](ade::iLeaf* leaf) -> std::string
+    {
+        auto vleaf = static_cast<ValuedLeaf*>(leaf);
+        if (false == vleaf->mergeable_)
+        {
+            return "";
+        }
+        return std::to_string(vleaf->val_);
+    });
+    ade::TensptrT merged = cse.merge(root);
+    auto mroot = dynamic_cast<ade::iFunctor*>(merged.get());
+    ASSERT_NE(nullptr, mroot);
+    const ade::ArgsT& children = mroot->get_children();
+    ASSERT_EQ(4, children.size());
+
+    // binar and binar2 only differ by equal subgraphs
+    EXPECT_EQ(children[0].get_tensor(), children[1].get_tensor());
+    // var2 has no key so it differs from var despite equal content
+    EXPECT_NE(children[0].get_tensor(), children[2].get_tensor());
+    EXPECT_EQ(unar3, children[2].get_tensor());
+    // flipped maps var differently from unar
+    EXPECT_EQ(flipped, children[3].get_tensor());
+
+    // merged subgraphs are shared between calls
+    EXPECT_EQ(children[0].get_tensor(), cse.merge(binar2));
+    EXPECT_EQ(one, cse.merge(one2));
+}
+
+
+TEST(CSE, Rebuild)
+{
+    ade::TensptrT one(new ValuedLeaf(1, true));
+    ade::TensptrT one2(new ValuedLeaf(1, true));
+    ade::TensptrT root(ade::Functor::get(
+        ade::Opcode{"binary", 1}, {
+            ade::identity_map(one),
+            ade::identity_map(one2),
+        }));
+
+    // functors with merged children are built by rebuild
+    std::vector<ade::iFunctor*> rebuilt;
+    ade::TensptrT replacement(new ValuedLeaf(2, false));
+    opt::CSE cse([](ade::iLeaf* leaf) -> std::string
+    {
+        return std::to_string(static_cast<ValuedLeaf*>(leaf)->val_);
+    },
+    [](ade::iFunctor*) { return true; },
+    [&](ade::iFunctor* func, ade::ArgsT args)
+    {
+        rebuilt.push_back(func);
+        EXPECT_EQ(2, args.size());
+        for (const ade::MappedTensor& arg : args)
+        {
+            EXPECT_EQ(one, arg.get_tensor());
+        }
+        return replacement;
+    });
+    EXPECT_EQ(replacement, cse.merge(root));
+    ASSERT_EQ(1, rebuilt.size());
+    EXPECT_EQ(root.get(), rebuilt[0]);
+}
+
+
+
+TEST(CSE, LeafEqual)
+{
+    ade::TensptrT one(new ValuedLeaf(1, true));
+    ade::TensptrT one2(new ValuedLeaf(1, true));
+    ade::TensptrT two(new ValuedLeaf(2, true));
+
+    // every leaf collides on one key, so only leaf_equal tells them apart
+    size_t ncompares = 0;
+    opt::CSE cse([](ade::iLeaf* leaf) -> std::string
+    {
+        return "collide";
+    },
+    [](ade::iFunctor*) { return true; },
+    opt::rebuild_functor,
+    [&](ade::iLeaf* a, ade::iLeaf* b)
+    {
+        ++ncompares;
+        return static_cast<ValuedLeaf*>(a)->val_ ==
+            static_cast<ValuedLeaf*>(b)->val_;
+    });
+    EXPECT_EQ(one, cse.merge(one));
+    EXPECT_EQ(0, ncompares);
+    EXPECT_EQ(two, cse.merge(two));
+    EXPECT_EQ(1, ncompares);
+    EXPECT_EQ(one, cse.merge(one2));
+}
+
+
+#endif // DISABLE_CSE_TEST
@@ -178,4 +178,77 @@ TEST(SHEAR, Prune)
 }
 
 
+
+TEST(SHEAR, PruneShared)
+{
+    ade::TensptrT leaf(new MockTensor(ade::Shape()));
+    ade::TensptrT leaf2(new MockTensor(ade::Shape()));
+    ade::TensptrT mortal(ade::Functor::get(
+        ade::Opcode{"killable", 0}, {ade::identity_map(leaf)}));
+    ade::TensptrT shared(ade::Functor::get(
+        ade::Opcode{"binary", 1}, {
+            ade::identity_map(leaf2),
+            ade::identity_map(mortal),
+        }));
+    ade::TensptrT root(ade::Functor::get(
+        ade::Opcode{"not_killable", 2}, {ade::identity_map(shared)}));
+    ade::TensptrT root2(ade::Functor::get(
+        ade::Opcode{"killable", 0}, {ade::identity_map(shared)}));
+
+    size_t nleaves = 0;
+    opt::GetLeafValT<bool> leaf1 = [&](ade::iLeaf* l)
+    {
+        ++nleaves;
+        return l == leaf.get();
+    };
+
+    std::unordered_map<ade::iTensor*,size_t> nprunes;
+    opt::PruneFuncT pruner = [&](ade::iFunctor* f,
+        std::unordered_set<size_t> target_indices,
+        ade::ArgsT args)
+    {
+        ++nprunes[f];
+        auto opcode = f->get_opcode();
+        if (opcode.code_ < 2) // killable
+        {
+            for (size_t index : target_indices)
+            {
+                args.erase(args.begin() + index);
+            }
+        }
+        if (args.size() > 0)
+        {
+            return ade::TensptrT(ade::Functor::get(opcode, args));
+        }
+        return leaf;
+    };
+
+    opt::TargetPruner<bool> mockpruner(true, leaf1, pruner);
+    ade::TensT roots = mockpruner.prune(ade::TensT{root, root2, leaf2});
+    ASSERT_EQ(3, roots.size());
+
+    // subgraphs shared between roots are searched and pruned once
+    EXPECT_EQ(2, nleaves);
+    EXPECT_EQ(4, nprunes.size());
+    for (auto& nprune : nprunes)
+    {
+        EXPECT_EQ(1, nprune.second);
+    }
+    // roots without paths to target are unchanged
+    EXPECT_EQ(leaf2, roots[2]);
+
+    std::unordered_map<ade::iTensor*,std::string> varlabels = {
+        {leaf.get(), "leaf"},
+        {leaf2.get(), "leaf2"},
+    };
+    std::stringstream str;
+    str <<
+        "(not_killable[1\\1\\1\\1\\1\\1\\1\\1])\n" <<
+        " `--(binary[1\\1\\1\\1\\1\\1\\1\\1])\n" <<
+        "     `--(leaf2=[1\\1\\1\\1\\1\\1\\1\\1])\n" <<
+        "     `--(killable[1\\1\\1\\1\\1\\1\\1\\1])\n" <<
+        "         `--(leaf=[1\\1\\1\\1\\1\\1\\1\\1])\n";
+    TREE_EQ(str, roots[0], varlabels);
+}
+
 #endif // DISABLE_SHEAR_TEST
@@ -0,0 +1,73 @@
+///
+/// codec.hpp
+/// pbm
+///
+/// Purpose:
+/// Define codecs compressing serialized source data
+///
+
+#include <functional>
+#include <string>
+
+#include "pbm/data.hpp"
+
+#ifndef PBM_CODEC_HPP
+#define PBM_CODEC_HPP
+
+namespace pbm
+{
+
+/// Identifiers of built-in codecs saved in cortenn::Source.codec
+enum CODEC_ID
+{
+	RAW_CODEC = 0,
+	LZ4_CODEC,
+	ZSTD_CODEC,
+};
+
+/// Compression functions of a codec
+struct Codec final
+{
+	/// Return compressed data
+	std::function<std::string(const std::string&)> encode_;
+
+	/// Decompress size bytes of data into out of nbytes,
+	/// where nbytes is the size of data before compression
+	std::function<void(char*,size_t,const char*,size_t)> decode_;
+};
+
+/// Register codec under id, replacing any codec of the same id
+void register_codec (uint32_t id, Codec codec);
+
+/// Return true if codec of id is registered
+bool has_codec (uint32_t id);
+
+/// Set codec and shuffle fields of source then return data encoded
+/// accordingly, where shuffling groups the i-th byte of every element
+/// together, which makes float data much more compressible
+/// Encoded data starts with the 8 byte little endian size of data
+/// unless it is raw and unshuffled
+std::string encode_data (cortenn::Source& source, std::string data,
+	uint32_t codec, bool shuffle);
+
+/// Return number of bytes of data once decoded according to source
+size_t decoded_size (const cortenn::Source& source, const std::string& data);
+
+/// Decode data according to codec and shuffle fields of source
+/// into out of decoded_size bytes
+void decode_data (char* out, const cortenn::Source& source,
+	const std::string& data);
+
+/// Return data decoded according to codec and shuffle fields of source
+std::string decode_data (const cortenn::Source& source,
+	const std::string& data);
+
+/// Return true if data of source needs decoding
+inline bool is_encoded (const cortenn::Source& source)
+{
+	return RAW_CODEC != source.codec() || source.shuffle();
+}
+
+}
+
+#endif // PBM_CODEC_HPP
@@ -28,9 +28,68 @@ using DataSaverT = std::function<std::string(const char*,size_t,size_t)>;
 using DataLoaderT = std::function<ade::TensptrT(const char*,ade::Shape,\
 	size_t,std::string)>;
 
+/// Properties of leaf saved alongside its data
+struct LeafInfo final
+{
+	/// True if data never changes, so loaded leaves can be optimized
+	bool constant_ = false;
+
+	/// Single value held by every element, null if elements differ
+	/// Only this value is saved, and loaders are given the loaded value
+	const char* value_ = nullptr;
+};
+
+/// Functor returning properties of leaf to save
+using LeafInfoT = std::function<LeafInfo(ade::iLeaf*)>;
+
+/// Data deserialization functor also given the saved properties of leaf
+using InfoLoaderT = std::function<ade::TensptrT(const char*,ade::Shape,\
+	size_t,std::string,LeafInfo)>;
+
+/// Functor returning serialized data of a source when called
+using DataFetchT = std::function<std::string(void)>;
+
+/// Deserialization functor of leaves whose data is only read through fetch
+using LazyLoaderT = std::function<ade::TensptrT(DataFetchT,ade::Shape,\
+	size_t,std::string,LeafInfo)>;
+
+/// Data chunk of a source in a streamed graph file
+struct ChunkRef final
+{
+	/// Path of the file
+	std::string path_;
+
+	/// Offset of the first byte of the chunk in the file
+	uint64_t offset_;
+
+	/// Number of bytes of the chunk
+	uint64_t size_;
+
+	/// True if the chunk holds serialized data as is, so it can be read
+	/// in place (e.g.: memory mapped) instead of through fetch_
+	bool raw_;
+
+	/// Return serialized data of the chunk, decoding it if not raw
+	DataFetchT fetch_;
+};
+
+/// Deserialization functor of leaves given where their data is in a file
+using ChunkLoaderT = std::function<ade::TensptrT(const ChunkRef&,\
+	ade::Shape,size_t,std::string,LeafInfo)>;
+
 /// String list type used for paths
 using StringsT = std::list<std::string>;
 
+/// Leading bytes identifying streamed graphs
+const std::string stream_magic = "CTNS";
+
+/// Version of the streamed graph layout
+/// Version 2 pads data chunks so they start at multiples of chunk_align
+const uint32_t stream_version = 2;
+
+/// Alignment in bytes of data chunks of streamed graphs
+const uint64_t chunk_align = 64;
+
 }
 
 #endif // PBM_COMMON_HPP
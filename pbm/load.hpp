@@ -6,6 +6,8 @@
 /// Define functions for marshal and unmarshal equation graph
 ///
 
+#include <istream>
+
 #include "pbm/data.hpp"
 
 #ifndef PBM_LOAD_HPP
@@ -152,6 +154,29 @@ struct GraphInfo final
 void load_graph (GraphInfo& out, const cortenn::Graph& in,
 	DataLoaderT dataloader);
 
+/// Return graph info through out available from in graph,
+/// giving dataloader the saved properties of every leaf
+void load_graph (GraphInfo& out, const cortenn::Graph& in,
+	InfoLoaderT dataloader);
+
+/// Return graph info through out available from graph streamed by
+/// GraphSaver, reading one data chunk at a time
+void load_graph (GraphInfo& out, std::istream& in, DataLoaderT dataloader);
+
+/// Return graph info through out available from graph streamed by
+/// GraphSaver, giving dataloader the saved properties of every leaf
+void load_graph (GraphInfo& out, std::istream& in, InfoLoaderT dataloader);
+
+/// Return graph info through out available from graph streamed to file
+/// at path, where only the topology is read and each source is given a
+/// fetch that reads its data chunk from the file when called
+void load_graph (GraphInfo& out, std::string path, LazyLoaderT lazyloader);
+
+/// Return graph info through out available from graph streamed to file
+/// at path, where only the topology is read and each source is given
+/// the location of its data chunk in the file
+void load_graph (GraphInfo& out, std::string path, ChunkLoaderT chunkloader);
+
 }
 
 #endif // PBM_GRAPH_HPP
@@ -7,8 +7,10 @@
 ///
 
 #include <list>
+#include <ostream>
 #include <unordered_set>
 
+#include "pbm/codec.hpp"
 #include "pbm/data.hpp"
 
 #ifndef PBM_SAVE_HPP
@@ -23,7 +25,18 @@ using PathedMapT = std::unordered_map<ade::TensptrT,StringsT>;
 /// Graph serialization traveler
 struct GraphSaver final : public ade::iTraveler
 {
-	GraphSaver (DataSaverT saver) : saver_(saver) {}
+	/// Save data serialized by saver and compressed by codec of specified id,
+	/// where bytes of elements are shuffled before compression if shuffle
+	GraphSaver (DataSaverT saver, uint32_t codec = RAW_CODEC,
+		bool shuffle = false) :
+		GraphSaver(saver, [](ade::iLeaf*) { return LeafInfo(); },
+			codec, shuffle) {}
+
+	/// Save data serialized by saver along with properties of each leaf
+	/// returned by info, compressed by codec of specified id
+	GraphSaver (DataSaverT saver, LeafInfoT info,
+		uint32_t codec = RAW_CODEC, bool shuffle = false) :
+		saver_(saver), info_(info), codec_(codec), shuffle_(shuffle) {}
 
 	/// Implementation of iTraveler
 	void visit (ade::iLeaf* leaf) override
@@ -56,6 +69,13 @@ struct GraphSaver final : public ade::iTraveler
 	/// Marshal all equation graphs in roots vector to protobuf object
 	void save (cortenn::Graph& out, PathedMapT labels = PathedMapT());
 
+	/// Stream all equation graphs in roots vector to out as a header,
+	/// every node without source data, then the data chunk of every source
+	/// Only one chunk is serialized at a time, so graphs with more data
+	/// than a single protobuf message can hold are saved in bounded memory
+	void save (std::ostream& out, PathedMapT labels = PathedMapT(),
+		std::string label = "");
+
 	/// List of leaves visited (left to right)
 	std::list<ade::iLeaf*> leaves_;
 
@@ -69,23 +89,44 @@ struct GraphSaver final : public ade::iTraveler
 	ade::GraphStat stat;
 
 private:
+	/// Marshal nodes to out, where data of sources is inlined
+	/// if inline_data, otherwise referenced by chunk index
+	void save_nodes (cortenn::Graph& out,
+		const PathedMapT& labels, bool inline_data);
+
 	void save_coord (
 		google::protobuf::RepeatedField<double>* coord,
 		const ade::CoordptrT& mapper);
 
 	void save_data (cortenn::Source& out, ade::iLeaf* in)
 	{
-		const ade::Shape& shape = in->shape();
-		char* data = (char*) in->data();
-		size_t nelems = shape.n_elems();
-		size_t tcode = in->type_code();
-		out.set_shape(std::string(shape.begin(), shape.end()));
-		out.set_data(saver_(data, nelems, tcode));
-		out.set_typecode(tcode);
+		out.set_data(save_chunk(out, in));
+	}
+
+	/// Return data of in serialized and encoded as recorded in source
+	std::string save_chunk (cortenn::Source& source, ade::iLeaf* in)
+	{
+		if (source.scalar())
+		{
+			// avoid expanding the single value of scalar leaves
+			return encode_data(source, saver_(info_(in).value_, 1,
+				in->type_code()), codec_, shuffle_);
+		}
+		return encode_data(source, saver_((char*) in->data(),
+			in->shape().n_elems(), in->type_code()), codec_, shuffle_);
 	}
 
 	/// Data serialization functor
 	DataSaverT saver_;
+
+	/// Functor returning properties of leaves
+	LeafInfoT info_;
+
+	/// Id of codec compressing data
+	uint32_t codec_;
+
+	/// True if bytes of elements are shuffled before compression
+	bool shuffle_;
 };
 
 }
@@ -0,0 +1,242 @@
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+#include "lz4.h"
+#include "zstd.h"
+
+#include "logs/logs.hpp"
+
+#include "pbm/codec.hpp"
+
+#ifdef PBM_CODEC_HPP
+
+namespace pbm
+{
+
+using CodecsT = std::unordered_map<uint32_t,Codec>;
+
+static CodecsT builtin_codecs (void)
+{
+	CodecsT codecs;
+	codecs.emplace(RAW_CODEC, Codec{
+		[](const std::string& data)
+		{
+			return data;
+		},
+		[](char* out, size_t nbytes, const char* data, size_t size)
+		{
+			if (size != nbytes)
+			{
+				logs::fatalf("cannot decode %d raw bytes into %d bytes",
+					size, nbytes);
+			}
+			std::memcpy(out, data, nbytes);
+		},
+	});
+	codecs.emplace(LZ4_CODEC, Codec{
+		[](const std::string& data)
+		{
+			if (data.size() > (size_t) LZ4_MAX_INPUT_SIZE)
+			{
+				logs::fatalf("cannot lz4 compress %d bytes", data.size());
+			}
+			std::string out(LZ4_compressBound(data.size()), '\0');
+			int n = LZ4_compress_default(data.c_str(), &out[0],
+				data.size(), out.size());
+			if (n <= 0)
+			{
+				logs::fatal("failed to lz4 compress data");
+			}
+			out.resize(n);
+			return out;
+		},
+		[](char* out, size_t nbytes, const char* data, size_t size)
+		{
+			int n = LZ4_decompress_safe(data, out, size, nbytes);
+			if (n < 0 || (size_t) n != nbytes)
+			{
+				logs::fatal("failed to lz4 decompress data");
+			}
+		},
+	});
+	codecs.emplace(ZSTD_CODEC, Codec{
+		[](const std::string& data)
+		{
+			std::string out(ZSTD_compressBound(data.size()), '\0');
+			size_t n = ZSTD_compress(&out[0], out.size(),
+				data.c_str(), data.size(), ZSTD_CLEVEL_DEFAULT);
+			if (ZSTD_isError(n))
+			{
+				logs::fatalf("failed to zstd compress data: %s",
+					ZSTD_getErrorName(n));
+			}
+			out.resize(n);
+			return out;
+		},
+		[](char* out, size_t nbytes, const char* data, size_t size)
+		{
+			size_t n = ZSTD_decompress(out, nbytes, data, size);
+			if (ZSTD_isError(n) || n != nbytes)
+			{
+				logs::fatal("failed to zstd decompress data");
+			}
+		},
+	});
+	return codecs;
+}
+
+static CodecsT& get_codecs (void)
+{
+	static CodecsT codecs = builtin_codecs();
+	return codecs;
+}
+
+/// Guard of registered codecs, since sources decode concurrently
+static std::mutex codecs_mutex;
+
+void register_codec (uint32_t id, Codec codec)
+{
+	std::lock_guard<std::mutex> lock(codecs_mutex);
+	get_codecs()[id] = codec;
+}
+
+bool has_codec (uint32_t id)
+{
+	std::lock_guard<std::mutex> lock(codecs_mutex);
+	CodecsT& codecs = get_codecs();
+	return codecs.end() != codecs.find(id);
+}
+
+static Codec get_codec (uint32_t id)
+{
+	std::lock_guard<std::mutex> lock(codecs_mutex);
+	CodecsT& codecs = get_codecs();
+	auto it = codecs.find(id);
+	if (codecs.end() == it)
+	{
+		logs::fatalf("cannot find codec %d", id);
+	}
+	return it->second;
+}
+
+/// Return number of elements saved in source's data
+static size_t source_nelems (const cortenn::Source& source)
+{
+	if (source.scalar())
+	{
+		return 1;
+	}
+	size_t n = 1;
+	for (unsigned char dim : source.shape())
+	{
+		n *= dim;
+	}
+	return n;
+}
+
+/// Write bytes of nelems elements of in transposed to out, so out holds
+/// the first byte of every element, then every second byte and so on
+/// Unshuffle by shuffling with nelems and elemsize swapped
+static void shuffle_bytes (char* out, const char* in,
+	size_t nelems, size_t elemsize)
+{
+	for (size_t i = 0; i < nelems; ++i)
+	{
+		for (size_t b = 0; b < elemsize; ++b)
+		{
+			out[b * nelems + i] = in[i * elemsize + b];
+		}
+	}
+}
+
+std::string encode_data (cortenn::Source& source, std::string data,
+	uint32_t codec, bool shuffle)
+{
+	source.set_codec(codec);
+	source.set_shuffle(shuffle);
+	if (false == is_encoded(source))
+	{
+		return data;
+	}
+	Codec encoder = get_codec(codec);
+	uint64_t nbytes = data.size();
+	if (shuffle)
+	{
+		size_t nelems = source_nelems(source);
+		if (0 != nbytes % nelems)
+		{
+			logs::fatalf("cannot shuffle %d bytes of %d elements",
+				nbytes, nelems);
+		}
+		std::string shuffled(nbytes, '\0');
+		shuffle_bytes(&shuffled[0], data.c_str(), nelems, nbytes / nelems);
+		data = std::move(shuffled);
+	}
+	std::string out(8, '\0');
+	for (size_t i = 0; i < 8; ++i)
+	{
+		out[i] = (nbytes >> (8 * i)) & 0xff;
+	}
+	return out + encoder.encode_(data);
+}
+
+size_t decoded_size (const cortenn::Source& source, const std::string& data)
+{
+	if (false == is_encoded(source))
+	{
+		return data.size();
+	}
+	if (data.size() < 8)
+	{
+		logs::fatal("cannot decode data without its size");
+	}
+	uint64_t nbytes = 0;
+	for (size_t i = 0; i < 8; ++i)
+	{
+		nbytes |= (uint64_t) (unsigned char) data[i] << (8 * i);
+	}
+	return nbytes;
+}
+
+void decode_data (char* out, const cortenn::Source& source,
+	const std::string& data)
+{
+	size_t nbytes = decoded_size(source, data);
+	if (false == is_encoded(source))
+	{
+		std::memcpy(out, data.c_str(), nbytes);
+		return;
+	}
+	Codec decoder = get_codec(source.codec());
+	// decompress straight into out unless it still needs unshuffling
+	std::string shuffled;
+	char* dest = out;
+	if (source.shuffle())
+	{
+		shuffled.resize(nbytes);
+		dest = &shuffled[0];
+	}
+	decoder.decode_(dest, nbytes, data.c_str() + 8, data.size() - 8);
+	if (source.shuffle())
+	{
+		size_t nelems = source_nelems(source);
+		shuffle_bytes(out, shuffled.c_str(), nbytes / nelems, nelems);
+	}
+}
+
+std::string decode_data (const cortenn::Source& source,
+	const std::string& data)
+{
+	if (false == is_encoded(source))
+	{
+		return data;
+	}
+	std::string out(decoded_size(source, data), '\0');
+	decode_data(&out[0], source, data);
+	return out;
+}
+
+}
+
+#endif
@@ -1,8 +1,16 @@
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <thread>
+
 #include "logs/logs.hpp"
 
 #include "ade/traveler.hpp"
 #include "ade/functor.hpp"
 
+#include "pbm/codec.hpp"
 #include "pbm/load.hpp"
 
 #ifdef PBM_LOAD_HPP
@@ -30,14 +38,32 @@ static ade::CoordptrT load_coord (
 		});
 }
 
-void load_graph (GraphInfo& out, const cortenn::Graph& in,
-	DataLoaderT dataloader)
+/// Functor returning leaf of source node of specified shape and label
+using SourceLoaderT = std::function<ade::TensptrT(
+	const cortenn::Source&,ade::Shape,std::string)>;
+
+static void load_nodes (GraphInfo& out, const cortenn::Graph& graph,
+	SourceLoaderT load_source)
 {
-	auto nodes = in.nodes();
+	// coordinate maps of the table are shared by every referencing arg
+	std::vector<ade::CoordptrT> coords = {ade::identity};
+	for (const cortenn::CoordMap& coord : graph.coords())
+	{
+		coords.push_back(load_coord(coord.values()));
+	}
+	auto get_coord = [&](uint32_t ref)
+	{
+		if (ref >= coords.size())
+		{
+			logs::fatalf("cannot reference coordinate map %d of %d maps",
+				ref, coords.size());
+		}
+		return coords[ref];
+	};
 	TensT invec;
-	for (const cortenn::Node& node : nodes)
+	for (const cortenn::Node& node : graph.nodes())
 	{
-		auto pb_labels = node.labels();
+		const auto& pb_labels = node.labels();
 		if (node.has_source())
 		{
 			std::string src_label;
@@ -46,12 +72,9 @@ void load_graph (GraphInfo& out, const cortenn::Graph& in,
 				src_label = *(pb_labels.rbegin());
 			}
 			const cortenn::Source& source = node.source();
-			std::string sstr = source.shape();
+			const std::string& sstr = source.shape();
 			ade::Shape shape(std::vector<ade::DimT>(sstr.begin(), sstr.end()));
-			size_t tcode = source.typecode();
-			std::string data = source.data();
-			ade::TensptrT leaf = dataloader(data.c_str(),
-				shape, tcode, src_label);
+			ade::TensptrT leaf = load_source(source, shape, src_label);
 			invec.push_back(leaf);
 			if (false == pb_labels.empty())
 			{
@@ -62,22 +85,33 @@ void load_graph (GraphInfo& out, const cortenn::Graph& in,
 		}
 		else
 		{
-			cortenn::Functor func = node.functor();
-			auto nodeargs = func.args();
+			const cortenn::Functor& func = node.functor();
+			const auto& nodeargs = func.args();
 			ade::ArgsT args;
-			for (auto nodearg : nodeargs)
+			for (const cortenn::NodeArg& nodearg : nodeargs)
 			{
 				ade::TensptrT arg = invec[nodearg.idx()];
-				ade::CoordptrT coord = load_coord(nodearg.coord());
+				ade::CoordptrT coord;
 				ade::CoordptrT shaper;
-				auto shaper_pb = nodearg.shaper();
-				if (shaper_pb.size() > 0)
+				const auto& shaper_pb = nodearg.shaper();
+				if (nodearg.coord().size() > 0)
 				{
-					shaper = load_coord(shaper_pb);
+					// inline maps of graphs saved without table
+					coord = load_coord(nodearg.coord());
+					if (shaper_pb.size() > 0)
+					{
+						shaper = load_coord(shaper_pb);
+					}
+					else
+					{
+						shaper = coord;
+					}
 				}
 				else
 				{
-					shaper = coord;
+					coord = get_coord(nodearg.coord_ref());
+					shaper = 0 == nodearg.shaper_ref() ?
+						coord : get_coord(nodearg.shaper_ref());
 				}
 				args.push_back(
 					ade::MappedTensor(arg, shaper, nodearg.fwd(), coord));
@@ -96,6 +130,352 @@ void load_graph (GraphInfo& out, const cortenn::Graph& in,
 	}
 }
 
+/// Return properties of leaf saved in source whose loaded data is pb
+static LeafInfo load_info (const cortenn::Source& source, const char* pb)
+{
+	LeafInfo info;
+	info.constant_ = source.constant();
+	if (source.scalar())
+	{
+		info.value_ = pb;
+	}
+	return info;
+}
+
+/// Return loader ignoring the saved properties of leaves
+static InfoLoaderT ignore_info (DataLoaderT dataloader)
+{
+	return [dataloader](const char* pb, ade::Shape shape, size_t typecode,
+		std::string label, LeafInfo info)
+	{
+		if (nullptr != info.value_)
+		{
+			// the loader would read every element of the single value
+			logs::fatalf("cannot load scalar source %s without LeafInfo",
+				label.c_str());
+		}
+		return dataloader(pb, shape, typecode, label);
+	};
+}
+
+/// Read size as 8 little endian bytes
+/// Return false if in ends before the size is read
+static bool read_size (std::istream& in, uint64_t& size)
+{
+	unsigned char prefix[8];
+	if (false == bool(in.read((char*) prefix, 8)))
+	{
+		return false;
+	}
+	size = 0;
+	for (size_t i = 0; i < 8; ++i)
+	{
+		size |= (uint64_t) prefix[i] << (8 * i);
+	}
+	return true;
+}
+
+/// Frames up to this size are read without checking the stream length
+const uint64_t frame_block = 1 << 20;
+
+/// Return number of bytes left in in,
+/// or the maximum size if in cannot seek
+static uint64_t remaining_size (std::istream& in)
+{
+	std::streampos pos = in.tellg();
+	if (pos < 0)
+	{
+		return std::numeric_limits<uint64_t>::max();
+	}
+	in.seekg(0, std::ios::end);
+	std::streampos end = in.tellg();
+	in.seekg(pos);
+	if (end < pos)
+	{
+		return std::numeric_limits<uint64_t>::max();
+	}
+	return end - pos;
+}
+
+/// Read size of data as 8 little endian bytes followed by data
+/// Return false if in ends before the entire frame is read
+static bool read_frame (std::istream& in, std::string& data)
+{
+	uint64_t size;
+	if (false == read_size(in, size) ||
+		(size > frame_block && size > remaining_size(in)))
+	{
+		return false;
+	}
+	// grow data by blocks, so a corrupt size in a stream that
+	// cannot seek fails when the stream ends instead of allocating it
+	data.clear();
+	while (data.size() < size)
+	{
+		size_t offset = data.size();
+		size_t n = std::min(size - offset, frame_block);
+		data.resize(offset + n);
+		if (false == bool(in.read(&data[offset], n)))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/// Skip padding preceding data chunks of streams from version 2 onwards
+/// Return false if in ends before the padding is skipped
+static bool skip_pad (std::istream& in, uint32_t version)
+{
+	if (version < 2)
+	{
+		return true;
+	}
+	uint64_t npad;
+	if (false == read_size(in, npad) || npad >= chunk_align)
+	{
+		return false;
+	}
+	in.ignore(npad);
+	return (uint64_t) in.gcount() == npad;
+}
+
+void load_graph (GraphInfo& out, const cortenn::Graph& in,
+	DataLoaderT dataloader)
+{
+	load_graph(out, in, ignore_info(dataloader));
+}
+
+void load_graph (GraphInfo& out, const cortenn::Graph& in,
+	InfoLoaderT dataloader)
+{
+	// load_nodes visits sources in node order, so queue encoded sources
+	// in the same order
+	std::vector<const cortenn::Source*> encoded;
+	for (const cortenn::Node& node : in.nodes())
+	{
+		if (node.has_source() && is_encoded(node.source()))
+		{
+			encoded.push_back(&node.source());
+		}
+	}
+	// decode sources in parallel at most a window ahead of the loader,
+	// so only the window's decoded data is held in memory
+	size_t window = std::max(1u, std::thread::hardware_concurrency());
+	std::deque<std::future<std::string>> decoding;
+	size_t next = 0;
+	auto decode_ahead = [&]()
+	{
+		for (; next < encoded.size() && decoding.size() < window; ++next)
+		{
+			const cortenn::Source* src = encoded[next];
+			decoding.push_back(std::async(std::launch::async,
+				[src]()
+				{
+					return decode_data(*src, src->data());
+				}));
+		}
+	};
+	decode_ahead();
+	std::string buffer;
+	load_nodes(out, in,
+		[&](const cortenn::Source& source, ade::Shape shape,
+			std::string label)
+		{
+			// read data in place instead of copying the message's bytes
+			const char* pb = source.data().c_str();
+			if (is_encoded(source))
+			{
+				// rethrows decoding errors
+				buffer = decoding.front().get();
+				decoding.pop_front();
+				decode_ahead();
+				pb = buffer.c_str();
+			}
+			return dataloader(pb, shape, source.typecode(), label,
+				load_info(source, pb));
+		});
+}
+
+/// Read header and nodes of graph streamed to in, leaving in at its chunks
+/// Return version of the stream's layout
+static uint32_t read_topology (cortenn::GraphHeader& header,
+	cortenn::Graph& graph, std::istream& in)
+{
+	std::string magic(stream_magic.size(), '\0');
+	unsigned char version[4];
+	if (false == bool(in.read(&magic[0], magic.size())) ||
+		stream_magic != magic ||
+		false == bool(in.read((char*) version, 4)))
+	{
+		logs::fatal("cannot load graph from unknown stream format");
+	}
+	uint32_t vers = 0;
+	for (size_t i = 0; i < 4; ++i)
+	{
+		vers |= (uint32_t) version[i] << (8 * i);
+	}
+	if (vers < 1 || vers > stream_version)
+	{
+		logs::fatalf("cannot load graph stream of version %d", vers);
+	}
+
+	std::string frame;
+	if (false == read_frame(in, frame) || false == header.ParseFromString(frame))
+	{
+		logs::fatal("failed to read graph stream header");
+	}
+	// nodes hold no source data, so the whole topology is small
+	graph.set_label(header.label());
+	graph.mutable_coords()->Swap(header.mutable_coords());
+	// every node frame holds at least its 8 byte size
+	if (header.nnodes() > remaining_size(in) / 8)
+	{
+		logs::fatalf("graph stream ends before its %d nodes",
+			header.nnodes());
+	}
+	for (size_t i = 0, n = header.nnodes(); i < n; ++i)
+	{
+		if (false == read_frame(in, frame) ||
+			false == graph.add_nodes()->ParseFromString(frame))
+		{
+			logs::fatalf("failed to read node %d of graph stream", i);
+		}
+	}
+	return vers;
+}
+
+void load_graph (GraphInfo& out, std::istream& in, DataLoaderT dataloader)
+{
+	load_graph(out, in, ignore_info(dataloader));
+}
+
+void load_graph (GraphInfo& out, std::istream& in, InfoLoaderT dataloader)
+{
+	cortenn::GraphHeader header;
+	cortenn::Graph graph;
+	uint32_t version = read_topology(header, graph, in);
+
+	std::string frame;
+	std::string buffer;
+	// sources reference chunks in the order they are streamed
+	size_t next_chunk = 0;
+	load_nodes(out, graph,
+		[&](const cortenn::Source& source, ade::Shape shape,
+			std::string label)
+		{
+			if (source.chunk() != next_chunk ||
+				next_chunk >= header.nchunks())
+			{
+				logs::fatalf("cannot load chunk %d of graph stream when "
+					"expecting chunk %d of %d", source.chunk(), next_chunk,
+					header.nchunks());
+			}
+			if (false == skip_pad(in, version) || false == read_frame(in, frame))
+			{
+				logs::fatalf("failed to read chunk %d of graph stream",
+					next_chunk);
+			}
+			++next_chunk;
+			const char* pb = frame.c_str();
+			if (is_encoded(source))
+			{
+				buffer.resize(decoded_size(source, frame));
+				decode_data(&buffer[0], source, frame);
+				pb = buffer.c_str();
+			}
+			return dataloader(pb, shape, source.typecode(),
+				label, load_info(source, pb));
+		});
+}
+
+void load_graph (GraphInfo& out, std::string path, LazyLoaderT lazyloader)
+{
+	load_graph(out, path,
+		[&](const ChunkRef& chunk, ade::Shape shape, size_t typecode,
+			std::string label, LeafInfo info)
+		{
+			return lazyloader(chunk.fetch_, shape, typecode, label, info);
+		});
+}
+
+void load_graph (GraphInfo& out, std::string path, ChunkLoaderT chunkloader)
+{
+	std::ifstream in(path, std::ios::in | std::ios::binary);
+	if (false == in.is_open())
+	{
+		logs::fatalf("cannot open %s to load graph", path.c_str());
+	}
+	cortenn::GraphHeader header;
+	cortenn::Graph graph;
+	uint32_t version = read_topology(header, graph, in);
+	// seeking past the end does not fail, so compare against its length
+	uint64_t start = in.tellg();
+	in.seekg(0, std::ios::end);
+	uint64_t length = in.tellg();
+	in.seekg(start);
+
+	// record where every chunk starts without reading its data
+	std::vector<std::pair<uint64_t,uint64_t>> chunks;
+	for (size_t i = 0, n = header.nchunks(); i < n; ++i)
+	{
+		uint64_t size;
+		if (false == skip_pad(in, version) || false == read_size(in, size))
+		{
+			logs::fatalf("failed to read chunk %d of graph stream", i);
+		}
+		uint64_t offset = in.tellg();
+		if (size > length - offset ||
+			false == bool(in.seekg(size, std::ios::cur)))
+		{
+			logs::fatalf("failed to read chunk %d of graph stream", i);
+		}
+		chunks.push_back({offset, size});
+	}
+	in.close();
+
+	load_nodes(out, graph,
+		[&](const cortenn::Source& source, ade::Shape shape,
+			std::string label)
+		{
+			if (source.chunk() >= chunks.size())
+			{
+				logs::fatalf("cannot load chunk %d of graph stream of %d "
+					"chunks", source.chunk(), chunks.size());
+			}
+			ChunkRef chunk;
+			chunk.path_ = path;
+			chunk.offset_ = chunks[source.chunk()].first;
+			chunk.size_ = chunks[source.chunk()].second;
+			chunk.raw_ = false == is_encoded(source);
+			uint64_t offset = chunk.offset_;
+			uint64_t size = chunk.size_;
+			chunk.fetch_ =
+				[path, offset, size, source]()
+				{
+					std::ifstream chunkin(path,
+						std::ios::in | std::ios::binary);
+					std::string data(size, '\0');
+					if (false == bool(chunkin.seekg(offset)) ||
+						(size > 0 && false == bool(chunkin.read(&data[0], size))))
+					{
+						logs::fatalf("failed to read %d bytes at offset %d "
+							"of %s", size, offset, path.c_str());
+					}
+					return decode_data(source, data);
+				};
+			if (source.scalar())
+			{
+				// single values are small enough to read right away
+				std::string value = chunk.fetch_();
+				return chunkloader(chunk, shape, source.typecode(), label,
+					load_info(source, value.c_str()));
+			}
+			return chunkloader(chunk, shape, source.typecode(), label,
+				load_info(source, nullptr));
+		});
+}
+
 }
 
 #endif
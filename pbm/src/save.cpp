@@ -10,7 +10,95 @@
 namespace pbm
 {
 
+/// Write size as 8 little endian bytes
+static void write_size (std::ostream& out, uint64_t size)
+{
+	char prefix[8];
+	for (size_t i = 0; i < 8; ++i)
+	{
+		prefix[i] = (size >> (8 * i)) & 0xff;
+	}
+	out.write(prefix, 8);
+}
+
+/// Write size of data as 8 little endian bytes followed by data
+static void write_frame (std::ostream& out, const std::string& data)
+{
+	write_size(out, data.size());
+	out.write(data.c_str(), data.size());
+}
+
+/// Write number of padding bytes as 8 little endian bytes followed by
+/// zeros, so data of the next frame starts at a multiple of chunk_align
+/// Streams without positions are not padded
+static void write_pad (std::ostream& out)
+{
+	std::streamoff pos = out.tellp();
+	uint64_t npad = 0;
+	if (pos >= 0)
+	{
+		// pad count and size of the next frame precede its data
+		npad = (chunk_align - (pos + 16) % chunk_align) % chunk_align;
+	}
+	write_size(out, npad);
+	out.write(std::string(npad, '\0').c_str(), npad);
+}
+
+/// Return bytes of mapper's matrix identifying equal coordinate maps
+static std::string coord_key (const ade::CoordptrT& mapper)
+{
+	std::string key;
+	mapper->access([&key](const ade::MatrixT& mat)
+	{
+		key = std::string((const char*) mat, sizeof(ade::MatrixT));
+	});
+	return key;
+}
+
 void GraphSaver::save (cortenn::Graph& out, PathedMapT labels)
+{
+	save_nodes(out, labels, true);
+}
+
+void GraphSaver::save (std::ostream& out, PathedMapT labels, std::string label)
+{
+	cortenn::Graph graph;
+	save_nodes(graph, labels, false);
+
+	cortenn::GraphHeader header;
+	header.set_label(label);
+	header.mutable_coords()->Swap(graph.mutable_coords());
+	header.set_nnodes(graph.nodes_size());
+	header.set_nchunks(leaves_.size());
+	out.write(stream_magic.c_str(), stream_magic.size());
+	char version[4];
+	for (size_t i = 0; i < 4; ++i)
+	{
+		version[i] = (stream_version >> (8 * i)) & 0xff;
+	}
+	out.write(version, 4);
+	write_frame(out, header.SerializeAsString());
+	for (const cortenn::Node& node : graph.nodes())
+	{
+		write_frame(out, node.SerializeAsString());
+	}
+	// leaves are saved in chunk order as the first nodes
+	size_t i = 0;
+	for (ade::iLeaf* leaf : leaves_)
+	{
+		cortenn::Source source = graph.nodes(i++).source();
+		std::string chunk = save_chunk(source, leaf);
+		write_pad(out);
+		write_frame(out, chunk);
+	}
+	if (false == out.good())
+	{
+		logs::fatal("failed to stream graph");
+	}
+}
+
+void GraphSaver::save_nodes (cortenn::Graph& out,
+	const PathedMapT& labels, bool inline_data)
 {
 	std::unordered_map<ade::iTensor*,StringsT> raw_labels;
 	for (auto lpair : labels)
@@ -18,6 +106,23 @@ void GraphSaver::save (cortenn::Graph& out, PathedMapT labels)
 		raw_labels[lpair.first.get()] = lpair.second;
 	}
 
+	// every distinct coordinate map is saved once to the graph's table
+	// and referenced by 1 + its index in the table
+	const std::string identity_key = coord_key(ade::identity);
+	std::unordered_map<std::string,uint32_t> coord_refs;
+	auto table_ref = [&](const std::string& key, const ade::CoordptrT& mapper)
+	{
+		auto it = coord_refs.find(key);
+		if (coord_refs.end() != it)
+		{
+			return it->second;
+		}
+		save_coord(out.add_coords()->mutable_values(), mapper);
+		uint32_t ref = out.coords_size();
+		coord_refs.emplace(key, ref);
+		return ref;
+	};
+
 	// sort functions from the root with the smallest subtree to the largest
 	// this ensures every children of a node appears before the parent,
 	// as is the order of node creations
@@ -46,7 +151,23 @@ void GraphSaver::save (cortenn::Graph& out, PathedMapT labels)
 				it->second.begin(), it->second.end());
 			pb_node->mutable_labels()->Swap(&vec);
 		}
-		save_data(*pb_node->mutable_source(), tens);
+		cortenn::Source* source = pb_node->mutable_source();
+		const ade::Shape& shape = tens->shape();
+		source->set_shape(std::string(shape.begin(), shape.end()));
+		source->set_typecode(tens->type_code());
+		source->set_codec(codec_);
+		source->set_shuffle(shuffle_);
+		LeafInfo info = info_(tens);
+		source->set_constant(info.constant_);
+		source->set_scalar(nullptr != info.value_);
+		if (inline_data)
+		{
+			save_data(*source, tens);
+		}
+		else
+		{
+			source->set_chunk(i);
+		}
 	}
 	for (size_t i = 0, n = funcs.size(); i < n; ++i)
 	{
@@ -71,10 +192,20 @@ void GraphSaver::save (cortenn::Graph& out, PathedMapT labels)
 			cortenn::NodeArg* arg = func->add_args();
 			ade::iTensor* tens = child.get_tensor().get();
 			arg->set_idx(ordermap[tens]);
-			save_coord(arg->mutable_coord(), child.get_coorder());
+			// identity coorders and shapers equal to their coorder
+			// are left as 0 and take no space
+			std::string ckey = coord_key(child.get_coorder());
+			if (identity_key != ckey)
+			{
+				arg->set_coord_ref(table_ref(ckey, child.get_coorder()));
+			}
 			if (child.get_shaper() != child.get_coorder())
 			{
-				save_coord(arg->mutable_shaper(), child.get_shaper());
+				std::string skey = coord_key(child.get_shaper());
+				if (ckey != skey)
+				{
+					arg->set_shaper_ref(table_ref(skey, child.get_shaper()));
+				}
 			}
 			arg->set_fwd(child.map_io());
 		}
@@ -8,7 +8,9 @@
 
 #include "dbg/ade.hpp"
 
+#include "pbm/codec.hpp"
 #include "pbm/load.hpp"
+#include "pbm/save.hpp"
 
 #include "pbm/test/common.hpp"
 
@@ -119,4 +121,435 @@ TEST(LOAD, LoadGraph)
 }
 
 
+TEST(LOAD, StreamGraph)
+{
+	cortenn::Graph graph;
+	{
+		std::fstream inputstr(testdir + "/graph.pb",
+			std::ios::in | std::ios::binary);
+		ASSERT_TRUE(inputstr.is_open());
+		ASSERT_TRUE(graph.ParseFromIstream(&inputstr));
+	}
+	pbm::GraphInfo graphinfo;
+	pbm::load_graph(graphinfo, graph,
+		[](const char* pb, ade::Shape shape,
+			size_t typecode, std::string label)
+		{
+			return ade::TensptrT(new MockTensor(shape));
+		});
+
+	pbm::PathedMapT labels;
+	for (auto& cpair : graphinfo.tens_.children_)
+	{
+		for (auto& tpair : cpair.second->tens_)
+		{
+			labels[tpair.second] = {cpair.first, tpair.first};
+		}
+	}
+	pbm::GraphSaver saver(
+		[](const char* in, size_t nelems, size_t typecode)
+		{
+			return std::string(nelems, 'x');
+		});
+	for (auto& root : graphinfo.roots_)
+	{
+		root->accept(saver);
+	}
+	std::stringstream stream;
+	saver.save(stream, labels, "streamed");
+
+	pbm::GraphInfo streaminfo;
+	pbm::load_graph(streaminfo, stream,
+		[](const char* pb, ade::Shape shape,
+			size_t typecode, std::string label)
+		{
+			EXPECT_STREQ(std::string(shape.n_elems(), 'x').c_str(), pb);
+			return ade::TensptrT(new MockTensor(shape));
+		});
+	EXPECT_EQ(2, streaminfo.roots_.size());
+
+	PrettyEquation artist;
+	for (std::string subtree : {"subtree", "subtree2"})
+	{
+		ade::TensptrT expect = graphinfo.tens_.get_labelled({subtree, "dest"});
+		ade::TensptrT got = streaminfo.tens_.get_labelled({subtree, "dest"});
+		ASSERT_NE(nullptr, got);
+		std::stringstream expectstr;
+		std::stringstream gotstr;
+		artist.print(expectstr, expect);
+		artist.print(gotstr, got);
+		EXPECT_STREQ(expectstr.str().c_str(), gotstr.str().c_str());
+	}
+
+	// corrupt sizes fail without allocating them
+	std::string prefix = pbm::stream_magic + std::string("\x02\0\0\0", 4);
+	cortenn::GraphHeader header;
+	header.set_nnodes(1ul << 60);
+	std::string headerstr = header.SerializeAsString();
+	std::string headersize(8, '\0');
+	headersize[0] = headerstr.size();
+	std::vector<std::pair<std::string,std::string>> corrupts = {
+		{prefix + std::string(7, '\xff') + '\x0f' + headerstr,
+			"failed to read graph stream header"},
+		{prefix + headersize + headerstr,
+			"graph stream ends before its"},
+	};
+	for (auto& corrupt : corrupts)
+	{
+		std::stringstream corruptstream(corrupt.first);
+		try
+		{
+			pbm::GraphInfo corruptinfo;
+			pbm::load_graph(corruptinfo, corruptstream,
+				[](const char* pb, ade::Shape shape,
+					size_t typecode, std::string label)
+				{
+					return ade::TensptrT(new MockTensor(shape));
+				});
+			ADD_FAILURE() << "expected loading corrupt stream to fail";
+		}
+		catch (std::runtime_error& e)
+		{
+			EXPECT_EQ(0, std::string(e.what()).find(corrupt.second));
+		}
+	}
+}
+
+
+TEST(LOAD, LazyGraph)
+{
+	std::string path = "lazy_graph.stream";
+	std::vector<ade::TensptrT> roots;
+	pbm::PathedMapT labels;
+	{
+		// sources of different sizes save different chunks
+		ade::TensptrT src(new MockTensor(ade::Shape({3, 2})));
+		ade::TensptrT src2(new MockTensor(ade::Shape({3})));
+		ade::TensptrT dest(ade::Functor::get(ade::Opcode{"+", 4}, {
+			{src, ade::identity},
+			{ade::TensptrT(ade::Functor::get(ade::Opcode{"neg", 3}, {
+				{src2, ade::identity},
+			})), ade::extend(1, {2})},
+		}));
+		roots.push_back(dest);
+		labels[src] = {"head", "src"};
+		labels[src2] = {"optimizer", "src2"};
+		labels[dest] = {"head", "dest"};
+	}
+	pbm::GraphSaver saver(
+		[](const char* in, size_t nelems, size_t typecode)
+		{
+			return std::to_string(nelems);
+		});
+	for (auto& root : roots)
+	{
+		root->accept(saver);
+	}
+	{
+		std::ofstream out(path, std::ios::out | std::ios::binary);
+		ASSERT_TRUE(out.is_open());
+		saver.save(out, labels);
+	}
+
+	// keep fetches of every source without calling them
+	std::unordered_map<std::string,pbm::DataFetchT> fetches;
+	pbm::GraphInfo graphinfo;
+	pbm::load_graph(graphinfo, path,
+		[&](pbm::DataFetchT fetch, ade::Shape shape,
+			size_t typecode, std::string label, pbm::LeafInfo info)
+		{
+			fetches.emplace(label, fetch);
+			return ade::TensptrT(new MockTensor(shape));
+		});
+	EXPECT_EQ(1, graphinfo.roots_.size());
+	ade::TensptrT dest = graphinfo.tens_.get_labelled({"head", "dest"});
+	ASSERT_NE(nullptr, dest);
+	EXPECT_STREQ("+", static_cast<ade::iFunctor*>(
+		dest.get())->get_opcode().name_.c_str());
+
+	// each source reads only its own chunk
+	ASSERT_EQ(2, fetches.size());
+	EXPECT_STREQ("6", fetches["src"]().c_str());
+	EXPECT_STREQ("3", fetches["src2"]().c_str());
+
+	// truncated files fail before any chunk is fetched
+	std::string content;
+	{
+		std::ifstream in(path, std::ios::in | std::ios::binary);
+		content.assign(std::istreambuf_iterator<char>(in),
+			std::istreambuf_iterator<char>());
+	}
+	{
+		std::ofstream out(path, std::ios::out | std::ios::binary);
+		out.write(content.c_str(), content.size() - 1);
+	}
+	try
+	{
+		pbm::GraphInfo truncated;
+		pbm::load_graph(truncated, path,
+			[&](pbm::DataFetchT fetch, ade::Shape shape,
+				size_t typecode, std::string label, pbm::LeafInfo info)
+			{
+				return ade::TensptrT(new MockTensor(shape));
+			});
+		ADD_FAILURE() << "expected loading truncated graph to fail";
+	}
+	catch (std::runtime_error& e)
+	{
+		EXPECT_STREQ("failed to read chunk 1 of graph stream", e.what());
+	}
+	std::remove(path.c_str());
+}
+
+
+TEST(LOAD, CodecGraph)
+{
+	// codec reversing its input to check encoding reaches every source
+	pbm::register_codec(100, pbm::Codec{
+		[](const std::string& data)
+		{
+			return std::string(data.rbegin(), data.rend());
+		},
+		[](char* out, size_t nbytes, const char* data, size_t size)
+		{
+			ASSERT_EQ(nbytes, size);
+			std::reverse_copy(data, data + size, out);
+		},
+	});
+	// 4 byte elements of every leaf counting up from the number of elements
+	auto serial = [](size_t nelems)
+	{
+		std::string out;
+		for (size_t i = 0; i < nelems; ++i)
+		{
+			uint32_t elem = nelems + i;
+			out.append((const char*) &elem, sizeof(uint32_t));
+		}
+		return out;
+	};
+	ade::TensptrT src(new MockTensor(ade::Shape({3, 2})));
+	ade::TensptrT src2(new MockTensor(ade::Shape({3, 2})));
+	ade::TensptrT dest(ade::Functor::get(ade::Opcode{"+", 4}, {
+		{src, ade::identity},
+		{src2, ade::identity},
+	}));
+	pbm::GraphSaver saver(
+		[&](const char* in, size_t nelems, size_t typecode)
+		{
+			return serial(nelems);
+		}, 100, true);
+	dest->accept(saver);
+
+	cortenn::Graph graph;
+	saver.save(graph);
+	std::stringstream stream;
+	saver.save(stream);
+	size_t nloaded = 0;
+	pbm::DataLoaderT loader =
+		[&](const char* pb, ade::Shape shape,
+			size_t typecode, std::string label)
+		{
+			std::string expect = serial(shape.n_elems());
+			EXPECT_EQ(0, std::memcmp(expect.c_str(), pb, expect.size()));
+			++nloaded;
+			return ade::TensptrT(new MockTensor(shape));
+		};
+	for (const cortenn::Node& node : graph.nodes())
+	{
+		if (node.has_source())
+		{
+			EXPECT_EQ(100, node.source().codec());
+			EXPECT_TRUE(node.source().shuffle());
+		}
+	}
+	pbm::GraphInfo info;
+	pbm::load_graph(info, graph, loader);
+	pbm::GraphInfo streaminfo;
+	pbm::load_graph(streaminfo, stream, loader);
+	EXPECT_EQ(4, nloaded);
+}
+
+
+
+TEST(LOAD, BuiltinCodecs)
+{
+	// repetitive 4 byte elements compress well once shuffled
+	auto serial = [](size_t nelems)
+	{
+		std::string out;
+		for (size_t i = 0; i < nelems; ++i)
+		{
+			uint32_t elem = i % 7;
+			out.append((const char*) &elem, sizeof(uint32_t));
+		}
+		return out;
+	};
+	ade::TensptrT src(new MockTensor(ade::Shape({255, 16})));
+	ade::TensptrT src2(new MockTensor(ade::Shape({255, 16})));
+	ade::TensptrT dest(ade::Functor::get(ade::Opcode{"+", 4}, {
+		{src, ade::identity},
+		{src2, ade::identity},
+	}));
+	for (uint32_t codec : {pbm::LZ4_CODEC, pbm::ZSTD_CODEC})
+	{
+		ASSERT_TRUE(pbm::has_codec(codec));
+		for (bool shuffle : {false, true})
+		{
+			pbm::GraphSaver saver(
+				[&](const char* in, size_t nelems, size_t typecode)
+				{
+					return serial(nelems);
+				}, codec, shuffle);
+			dest->accept(saver);
+
+			cortenn::Graph graph;
+			saver.save(graph);
+			std::stringstream stream;
+			saver.save(stream);
+			for (const cortenn::Node& node : graph.nodes())
+			{
+				if (node.has_source())
+				{
+					EXPECT_GT(255 * 16 * sizeof(uint32_t),
+						node.source().data().size());
+				}
+			}
+			size_t nloaded = 0;
+			pbm::DataLoaderT loader =
+				[&](const char* pb, ade::Shape shape,
+					size_t typecode, std::string label)
+				{
+					std::string expect = serial(shape.n_elems());
+					EXPECT_EQ(0, std::memcmp(expect.c_str(), pb, expect.size()));
+					++nloaded;
+					return ade::TensptrT(new MockTensor(shape));
+				};
+			pbm::GraphInfo info;
+			pbm::load_graph(info, graph, loader);
+			pbm::GraphInfo streaminfo;
+			pbm::load_graph(streaminfo, stream, loader);
+			EXPECT_EQ(4, nloaded);
+		}
+	}
+}
+
+
+
+TEST(LOAD, LeafInfo)
+{
+	std::string path = "info_graph.stream";
+	ade::TensptrT src(new MockTensor(ade::Shape({3, 2})));
+	ade::TensptrT src2(new MockTensor(ade::Shape({3, 2})));
+	ade::TensptrT dest(ade::Functor::get(ade::Opcode{"+", 4}, {
+		{src, ade::identity},
+		{src2, ade::identity},
+	}));
+	pbm::PathedMapT labels = {
+		{src, {"src"}},
+		{src2, {"src2"}},
+	};
+	pbm::GraphSaver saver(
+		[](const char* in, size_t nelems, size_t typecode)
+		{
+			return std::string(nelems, 'x');
+		},
+		[&](ade::iLeaf* leaf)
+		{
+			pbm::LeafInfo info;
+			info.constant_ = leaf == src.get();
+			if (leaf == src2.get())
+			{
+				info.value_ = "y";
+			}
+			return info;
+		});
+	dest->accept(saver);
+
+	cortenn::Graph graph;
+	saver.save(graph, labels);
+	std::stringstream stream;
+	saver.save(stream, labels);
+	{
+		std::ofstream out(path, std::ios::out | std::ios::binary);
+		ASSERT_TRUE(out.is_open());
+		saver.save(out, labels);
+	}
+
+	// scalar leaves save only their single value
+	for (const cortenn::Node& node : graph.nodes())
+	{
+		if (node.has_source())
+		{
+			bool scalar = node.source().scalar();
+			EXPECT_STREQ(scalar ? "x" : "xxxxxx",
+				node.source().data().c_str());
+		}
+	}
+
+	std::unordered_map<std::string,bool> constants;
+	std::unordered_map<std::string,std::string> values;
+	pbm::InfoLoaderT loader =
+		[&](const char* pb, ade::Shape shape, size_t typecode,
+			std::string label, pbm::LeafInfo info)
+		{
+			constants[label] = info.constant_;
+			if (nullptr != info.value_)
+			{
+				EXPECT_EQ(pb, info.value_);
+				values[label] = std::string(info.value_, 1);
+			}
+			return ade::TensptrT(new MockTensor(shape));
+		};
+	auto expect_info = [&]()
+	{
+		EXPECT_TRUE(constants["src"]);
+		EXPECT_FALSE(constants["src2"]);
+		EXPECT_EQ(1, values.size());
+		EXPECT_STREQ("x", values["src2"].c_str());
+		constants.clear();
+		values.clear();
+	};
+	pbm::GraphInfo info;
+	pbm::load_graph(info, graph, loader);
+	expect_info();
+
+	pbm::GraphInfo streaminfo;
+	pbm::load_graph(streaminfo, stream, loader);
+	expect_info();
+
+	pbm::GraphInfo lazyinfo;
+	pbm::load_graph(lazyinfo, path,
+		[&](pbm::DataFetchT fetch, ade::Shape shape,
+			size_t typecode, std::string label, pbm::LeafInfo info)
+		{
+			constants[label] = info.constant_;
+			if (nullptr != info.value_)
+			{
+				values[label] = std::string(info.value_, 1);
+			}
+			return ade::TensptrT(new MockTensor(shape));
+		});
+	expect_info();
+	std::remove(path.c_str());
+
+	// loaders unaware of scalars cannot read them
+	pbm::GraphInfo dataloaded;
+	try
+	{
+		pbm::load_graph(dataloaded, graph,
+			[](const char* pb, ade::Shape shape,
+				size_t typecode, std::string label)
+			{
+				return ade::TensptrT(new MockTensor(shape));
+			});
+		ADD_FAILURE() << "expected loading scalar without LeafInfo to fail";
+	}
+	catch (std::runtime_error& e)
+	{
+		EXPECT_STREQ("cannot load scalar source src2 without LeafInfo",
+			e.what());
+	}
+}
+
+
 #endif // DISABLE_LOAD_TEST
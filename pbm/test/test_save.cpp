@@ -8,6 +8,7 @@
 
 #include "ade/functor.hpp"
 
+#include "pbm/load.hpp"
 #include "pbm/save.hpp"
 
 #include "pbm/test/common.hpp"
@@ -133,4 +134,68 @@ TEST(SAVE, SaveGraph)
 }
 
 
+TEST(SAVE, CoordTable)
+{
+	ade::TensptrT src(new MockTensor(ade::Shape({3, 7})));
+	ade::TensptrT src2(new MockTensor(ade::Shape({7, 3})));
+	ade::TensptrT dest(ade::Functor::get(ade::Opcode{"+", 4}, {
+		{ade::TensptrT(ade::Functor::get(ade::Opcode{"neg", 3}, {
+			{src, ade::permute({1, 0})},
+		})), ade::identity},
+		{ade::TensptrT(ade::Functor::get(ade::Opcode{"sin", 5}, {
+			{src, ade::permute({1, 0})},
+		})), ade::identity},
+		{src2, ade::identity},
+	}));
+
+	pbm::GraphSaver saver(
+		[](const char* in, size_t nelems, size_t typecode)
+		{
+			return std::string(nelems, 0);
+		});
+	dest->accept(saver);
+	cortenn::Graph graph;
+	saver.save(graph);
+
+	// both permutes share one entry and identities are not stored
+	ASSERT_EQ(1, graph.coords_size());
+	size_t nidentity = 0;
+	for (const cortenn::Node& node : graph.nodes())
+	{
+		if (node.has_functor())
+		{
+			for (const cortenn::NodeArg& arg : node.functor().args())
+			{
+				EXPECT_EQ(0, arg.coord_size());
+				EXPECT_EQ(0, arg.shaper_ref());
+				if (0 == arg.coord_ref())
+				{
+					++nidentity;
+				}
+			}
+		}
+	}
+	EXPECT_EQ(3, nidentity);
+
+	pbm::GraphInfo info;
+	pbm::load_graph(info, graph,
+		[](const char* pb, ade::Shape shape,
+			size_t typecode, std::string label)
+		{
+			return ade::TensptrT(new MockTensor(shape));
+		});
+	ASSERT_EQ(1, info.roots_.size());
+	auto root = static_cast<ade::iFunctor*>(info.roots_.begin()->get());
+	const ade::ArgsT& args = root->get_children();
+	ASSERT_EQ(3, args.size());
+	auto neg = static_cast<ade::iFunctor*>(args[0].get_tensor().get());
+	auto sin = static_cast<ade::iFunctor*>(args[1].get_tensor().get());
+	EXPECT_EQ(ade::identity, args[0].get_coorder());
+	EXPECT_EQ(neg->get_children()[0].get_coorder(),
+		sin->get_children()[0].get_coorder());
+	EXPECT_STREQ(ade::Shape({7, 3}).to_string().c_str(),
+		neg->shape().to_string().c_str());
+}
+
+
 #endif // DISABLE_SAVE_TEST
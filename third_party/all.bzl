@@ -1,15 +1,20 @@
 load("//third_party/repos:eigen.bzl", "eigen_repository")
+load("//third_party/repos:lz4.bzl", "lz4_repository")
 load("//third_party/repos:numpy.bzl", "numpy_repository")
 load("//third_party/repos:protobuf.bzl", "protobuf_rules_repository")
 load("//third_party/repos:pybind11.bzl", "pybind11_repository")
 load("//third_party/repos:python.bzl", "python_repository")
 load("//third_party/repos:tenncor.bzl", "tenncor_repository")
+load("//third_party/repos:zstd.bzl", "zstd_repository")
 
 def dependencies(excludes = []):
     ignores = native.existing_rules().keys() + excludes
     if "eigen" not in ignores:
         eigen_repository(name = "eigen")
 
+    if "lz4" not in ignores:
+        lz4_repository(name = "lz4")
+
     if "numpy" not in ignores:
         numpy_repository(name = "numpy")
 
@@ -24,3 +29,6 @@ def dependencies(excludes = []):
 
     if "com_github_mingkaic_tenncor" not in ignores:
         tenncor_repository()
+
+    if "zstd" not in ignores:
+        zstd_repository(name = "zstd")
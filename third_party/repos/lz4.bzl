@@ -0,0 +1,23 @@
+load("@bazel_tools//tools/build_defs/repo:git.bzl", "new_git_repository")
+
+_BUILD_CONTENT = """licenses(["notice"])  # BSD-2-Clause
+
+package(
+    default_visibility = ["//visibility:public"],
+)
+
+cc_library(
+    name = "lz4",
+    srcs = ["lib/lz4.c"],
+    hdrs = ["lib/lz4.h"],
+    includes = ["lib"],
+)
+"""
+
+def lz4_repository(name):
+    new_git_repository(
+        name = name,
+        remote = "https://github.com/lz4/lz4.git",
+        tag = "v1.8.3",
+        build_file_content = _BUILD_CONTENT,
+    )
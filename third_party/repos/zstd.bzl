@@ -0,0 +1,32 @@
+load("@bazel_tools//tools/build_defs/repo:git.bzl", "new_git_repository")
+
+_BUILD_CONTENT = """licenses(["notice"])  # BSD-3-Clause
+
+package(
+    default_visibility = ["//visibility:public"],
+)
+
+cc_library(
+    name = "zstd",
+    srcs = glob([
+        "lib/common/*.c",
+        "lib/common/*.h",
+        "lib/compress/*.c",
+        "lib/compress/*.h",
+        "lib/decompress/*.c",
+        "lib/decompress/*.h",
+    ]),
+    hdrs = ["lib/zstd.h"],
+    includes = ["lib"],
+    copts = ["-Iexternal/zstd/lib/common"],
+    linkopts = ["-pthread"],
+)
+"""
+
+def zstd_repository(name):
+    new_git_repository(
+        name = name,
+        remote = "https://github.com/facebook/zstd.git",
+        tag = "v1.3.8",
+        build_file_content = _BUILD_CONTENT,
+    )